@@ -29,7 +29,15 @@ namespace Kiwi
     //                                      ATOM                                        //
     // ================================================================================ //
     
-    Atom::Atom(Atom::Atom const& other) noexcept
+    static void writeJsonString(ostream& output, string_view text)
+    {
+        thread_local string buffer;
+        buffer.clear();
+        jsonEscape(text, buffer);
+        output.write(buffer.data(), streamsize(buffer.size()));
+    }
+    
+    Atom::Atom(Atom const& other) noexcept
     {
         if(other.isBool())
         {
@@ -49,11 +57,11 @@ namespace Kiwi
         }
         else if(other.isVector())
         {
-            m_quark = new QuarkVector((Vector const&)other);
+            m_quark = new QuarkVector(*static_cast<QuarkVector*>(other.m_quark));
         }
         else if(other.isDico())
         {
-            m_quark = new QuarkDico((Dico const&)other);
+            m_quark = new QuarkDico(*static_cast<QuarkDico*>(other.m_quark));
         }
         else
         {
@@ -83,11 +91,11 @@ namespace Kiwi
         }
         else if(other.isVector())
         {
-            m_quark = new QuarkVector((Vector const&)other);
+            m_quark = new QuarkVector(*static_cast<QuarkVector*>(other.m_quark));
         }
         else if(other.isDico())
         {
-            m_quark = new QuarkDico((Dico const&)other);
+            m_quark = new QuarkDico(*static_cast<QuarkDico*>(other.m_quark));
         }
         else
         {
@@ -96,7 +104,182 @@ namespace Kiwi
         return *this;
     }
     
-    ostream& Atom::toJson(ostream &output, const Atom &atom, ulong& indent)
+    bool Atom::operator==(char const* tag) const noexcept
+    {
+        return isTag() && m_quark->getTag()->getName() == string_view(tag);
+    }
+    
+    bool Atom::operator==(string const& tag) const noexcept
+    {
+        return isTag() && m_quark->getTag()->getName() == string_view(tag);
+    }
+    
+    bool Atom::operator==(sTag tag) const noexcept
+    {
+        return isTag() && m_quark->getTag() == tag;
+    }
+    
+    // Mixes a value into the second hash of the atoms, with other constants than hashCombine so the two hashes don't collide together.
+    static inline uint64_t checkCombine(const uint64_t seed, uint64_t value) noexcept
+    {
+        value = (value ^ ((seed << 23) | (seed >> 41))) * 0xff51afd7ed558ccdull;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ull;
+        return value ^ (value >> 29);
+    }
+    
+    // Mixes the name of a tag into the second hash of the atoms, the hash of the tag can't be reused since it's the one of the content hash.
+    static inline uint64_t checkName(uint64_t seed, string_view name) noexcept
+    {
+        seed = checkCombine(seed, uint64_t(name.size()));
+        for(size_t i = 0; i < name.size(); i += 8)
+        {
+            uint64_t word = 0ull;
+            memcpy(&word, name.data() + i, min(size_t(8), name.size() - i));
+            seed = checkCombine(seed, word);
+        }
+        return seed;
+    }
+    
+    uint64_t Atom::getHash() const noexcept
+    {
+        uint64_t check;
+        return getHash(check);
+    }
+    
+    uint64_t Atom::getHash(uint64_t& check) const noexcept
+    {
+        const Type type = getType();
+        uint64_t hash = hashCombine(0ull, uint64_t(type));
+        check = checkCombine(0ull, uint64_t(type));
+        if(type == BOOLEAN || type == LONG)
+        {
+            hash = hashCombine(hash, uint64_t(m_quark->getLong()));
+            check = checkCombine(check, uint64_t(m_quark->getLong()));
+        }
+        else if(type == DOUBLE)
+        {
+            const double value = m_quark->getDouble();
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            hash = hashCombine(hash, bits);
+            check = checkCombine(check, bits);
+        }
+        else if(type == TAG)
+        {
+            const sTag tag = m_quark->getTag();
+            hash = hashCombine(hash, tag->getHash());
+            check = checkName(check, tag->getName());
+        }
+        else if(type == VECTOR || type == DICO)
+        {
+            // the vectors and the dicos never change after their creation so their hashes are computed once
+            atomic<uint64_t>& memo = (type == VECTOR) ? static_cast<QuarkVector*>(m_quark)->hash : static_cast<QuarkDico*>(m_quark)->hash;
+            atomic<uint64_t>& checked = (type == VECTOR) ? static_cast<QuarkVector*>(m_quark)->check : static_cast<QuarkDico*>(m_quark)->check;
+            uint64_t value = memo.load(memory_order_relaxed), second = checked.load(memory_order_relaxed);
+            if(!value || !second)
+            {
+                value = hash;
+                second = check;
+                uint64_t child;
+                if(type == VECTOR)
+                {
+                    for(auto const& atom : static_cast<QuarkVector*>(m_quark)->val)
+                    {
+                        value = hashCombine(value, atom.getHash(child));
+                        second = checkCombine(second, child);
+                    }
+                }
+                else
+                {
+                    for(auto const& it : static_cast<QuarkDico*>(m_quark)->val)
+                    {
+                        value = hashCombine(hashCombine(value, it.first->getHash()), it.second.getHash(child));
+                        second = checkCombine(checkName(second, it.first->getName()), child);
+                    }
+                }
+                value = value ? value : 1ull;
+                second = second ? second : 1ull;
+                checked.store(second, memory_order_relaxed);
+                memo.store(value, memory_order_relaxed);
+            }
+            hash = value;
+            check = second;
+        }
+        return hash;
+    }
+    
+    // The stream buffer that copies the text written to a stream to the cache, it replaces the buffer of the stream while the subtrees that aren't found are written.
+    class Atom::Cache::Capture : public streambuf
+    {
+    private:
+        ostream&            m_stream;
+        streambuf* const    m_output;
+        Cache&              m_cache;
+        const ios::iostate  m_state;
+        bool                m_finished;
+        
+    protected:
+        
+        int_type overflow(int_type c) override
+        {
+            if(traits_type::eq_int_type(c, traits_type::eof()))
+            {
+                return traits_type::not_eof(c);
+            }
+            const char character = traits_type::to_char_type(c);
+            if(traits_type::eq_int_type(m_output->sputc(character), traits_type::eof()))
+            {
+                return traits_type::eof();
+            }
+            m_cache.append(&character, 1ul);
+            return c;
+        }
+        
+        streamsize xsputn(const char* text, streamsize size) override
+        {
+            const streamsize written = m_output->sputn(text, size);
+            if(written > 0)
+            {
+                m_cache.append(text, ulong(written));
+            }
+            return written;
+        }
+        
+        int sync() override
+        {
+            return m_output->pubsync();
+        }
+        
+    public:
+        
+        inline Capture(ostream& stream, Cache& cache) : m_stream(stream), m_output(stream.rdbuf()), m_cache(cache), m_state(stream.rdstate()), m_finished(false)
+        {
+            m_stream.rdbuf(this);
+        }
+        
+        // Gives its buffer back to the stream with the errors of the writes.
+        inline void finish()
+        {
+            const ios::iostate state = m_stream.rdstate();
+            m_finished = true;
+            m_stream.rdbuf(m_output);
+            m_stream.setstate(m_state | state);
+        }
+        
+        inline ~Capture() noexcept
+        {
+            if(!m_finished)
+            {
+                // an exception is thrown through the stream, the subtrees being written are dropped
+                m_stream.rdbuf(m_output);
+            }
+            m_cache.m_starts.clear();
+            m_cache.m_text.clear();
+        }
+    };
+    
+    void Atom::writeJson(ostream &output, const Atom &atom, ulong& indent, Cache* cache)
     {
         if(atom.isBool())
         {
@@ -108,19 +291,83 @@ namespace Kiwi
         }
         else if(atom.isDouble())
         {
-            output << (double)atom;
+            char buffer[48];
+            char* end = toChars(buffer, buffer + sizeof(buffer) - 2, (double)atom);
+            if(isIntegral(buffer, end))
+            {
+                *end++ = '.';
+                *end++ = '0';
+            }
+            output.write(buffer, end - buffer);
         }
         else if(atom.isTag())
         {
-            output << jsonEscape(((sTag)atom)->getName());
+            writeJsonString(output, ((sTag)atom)->getName());
         }
-        else if(atom.isVector())
+        else if(cache && (atom.isVector() || atom.isDico()) && output.good())
         {
-            Vector const& vec = atom;
+            // the vectors of a few numbers and tags are cheaper to write than to look up
+            ulong size;
+            bool cached;
+            if(atom.isVector())
+            {
+                Vector const& vec = static_cast<QuarkVector*>(atom.m_quark)->val;
+                size    = ulong(vec.size());
+                cached  = size >= 16ul || any_of(vec.begin(), vec.end(), [](Atom const& child){return child.isVector() || child.isDico();});
+            }
+            else
+            {
+                size    = ulong(static_cast<QuarkDico*>(atom.m_quark)->val.size());
+                cached  = size != 0ul;
+            }
+            
+            if(cached)
+            {
+                uint64_t check;
+                uint64_t hash = atom.getHash(check);
+                hash = cache->m_hash ? cache->m_hash(atom) : hash;
+                const uint64_t key = hashCombine(hashCombine(hashCombine(hash, uint64_t(indent)), uint64_t(output.flags())), uint64_t(output.precision()));
+                string const* text = cache->find(key, hash, check, indent, size);
+                if(text)
+                {
+                    output.write(text->data(), streamsize(text->size()));
+                }
+                else if(cache->m_starts.empty())
+                {
+                    // the first subtree that isn't found copies the text written to the stream for itself and its subtrees
+                    Cache::Capture capture(output, *cache);
+                    cache->begin();
+                    writeJsonTree(output, atom, indent, cache);
+                    cache->end(key, hash, check, indent, size);
+                    capture.finish();
+                }
+                else
+                {
+                    cache->begin();
+                    writeJsonTree(output, atom, indent, cache);
+                    cache->end(key, hash, check, indent, size);
+                }
+            }
+            else
+            {
+                writeJsonTree(output, atom, indent, cache);
+            }
+        }
+        else
+        {
+            writeJsonTree(output, atom, indent, cache);
+        }
+    }
+    
+    void Atom::writeJsonTree(ostream &output, const Atom &atom, ulong& indent, Cache* cache)
+    {
+        if(atom.isVector())
+        {
+            Vector const& vec = static_cast<QuarkVector*>(atom.m_quark)->val;
             output << '[';
             for(Vector::size_type i = 0; i < vec.size();)
             {
-                toJson(output, vec[i], indent);
+                writeJson(output, vec[i], indent, cache);
                 if(++i != vec.size())
                 {
                     output << ", ";
@@ -130,8 +377,8 @@ namespace Kiwi
         }
         else if(atom.isDico())
         {
-            Dico const& dico = atom;
-            output << '{' << endl;
+            Dico const& dico = static_cast<QuarkDico*>(atom.m_quark)->val;
+            output << '{' << '\n';
             ++indent;
             for(auto it = dico.begin(); it != dico.end();)
             {
@@ -139,15 +386,16 @@ namespace Kiwi
                 {
                     output << '\t';
                 }
-                output << jsonEscape(it->first->getName()) << " : ";
-                toJson(output, it->second, indent);
+                writeJsonString(output, it->first->getName());
+                output << " : ";
+                writeJson(output, it->second, indent, cache);
                 if(++it != dico.end())
                 {
-                    output << ',' << endl;
+                    output << ',' << '\n';
                 }
                 else
                 {
-                    output << endl;
+                    output << '\n';
                 }
             }
             --indent;
@@ -157,9 +405,225 @@ namespace Kiwi
             }
             output << '}';
         }
+    }
+    
+    ostream& Atom::toJson(ostream &output, const Atom &atom, ulong& indent)
+    {
+        writeJson(output, atom, indent, nullptr);
+        return output;
+    }
+    
+    ostream& Atom::toJson(ostream &output, const Atom &atom, ulong& indent, Cache& cache)
+    {
+        writeJson(output, atom, indent, &cache);
         return output;
     }
     
+    class JsonReader
+    {
+    private:
+        const char* m_first;
+        const char* m_current;
+        const char* m_last;
+        string      m_name;
+        
+    public:
+        JsonReader(string_view text) noexcept :
+        m_first(text.data()), m_current(text.data()), m_last(text.data() + text.size()) {}
+        
+        [[noreturn]] void fail(const char* message) const
+        {
+            throw Error(string("Invalid json at ") + toString(ulong(m_current - m_first)) + " : " + message);
+        }
+        
+        void skip() noexcept
+        {
+            while(m_current != m_last && (*m_current == ' ' || *m_current == '\t' || *m_current == '\n' || *m_current == '\r'))
+            {
+                ++m_current;
+            }
+        }
+        
+        bool end() noexcept
+        {
+            skip();
+            return m_current == m_last;
+        }
+        
+        sTag readTag()
+        {
+            const char* first = ++m_current;
+            while(true)
+            {
+                m_current = jsonFindUnescape(m_current, m_last);
+                if(m_current == m_last)
+                {
+                    fail("unterminated string");
+                }
+                else if(*m_current == '\"')
+                {
+                    break;
+                }
+                m_current += 2;
+                if(m_current > m_last)
+                {
+                    fail("unterminated string");
+                }
+            }
+            const string_view name(first, size_t(m_current - first));
+            ++m_current;
+            if(name.find('\\') == string_view::npos)
+            {
+                return Tag::create(name);
+            }
+            m_name.clear();
+            jsonUnescape(name, m_name);
+            return Tag::create(m_name);
+        }
+        
+        Atom readNumber()
+        {
+            const char* first = m_current;
+            bool isFloat = false;
+            while(m_current != m_last && !strchr(" \t\n\r,]}:", *m_current))
+            {
+                isFloat = isFloat || *m_current == '.' || *m_current == 'e' || *m_current == 'E' || *m_current == 'n' || *m_current == 'i';
+                ++m_current;
+            }
+            const string_view word(first, size_t(m_current - first));
+            if(!isFloat)
+            {
+                const Conversion<long> value = fromChars<long>(word);
+                if(value)
+                {
+                    return Atom(value.value);
+                }
+            }
+            const Conversion<double> value = fromChars<double>(word);
+            if(!value)
+            {
+                m_current = first;
+                fail("invalid value");
+            }
+            return Atom(value.value);
+        }
+        
+        bool readWord(const char* word, const size_t size) noexcept
+        {
+            if(size_t(m_last - m_current) >= size && memcmp(m_current, word, size) == 0)
+            {
+                m_current += size;
+                return true;
+            }
+            return false;
+        }
+        
+        Atom read(const ulong depth = 0ul)
+        {
+            if(end())
+            {
+                fail("missing value");
+            }
+            if(depth > 512ul)
+            {
+                fail("too many nested values");
+            }
+            switch(*m_current)
+            {
+                case '\"':
+                    return Atom(readTag());
+                case '[':
+                {
+                    ++m_current;
+                    Vector atoms;
+                    if(!end() && *m_current == ']')
+                    {
+                        ++m_current;
+                        return Atom(move(atoms));
+                    }
+                    while(true)
+                    {
+                        atoms.push_back(read(depth + 1));
+                        if(end())
+                        {
+                            fail("unterminated array");
+                        }
+                        if(*m_current++ == ']')
+                        {
+                            return Atom(move(atoms));
+                        }
+                        else if(m_current[-1] != ',')
+                        {
+                            --m_current;
+                            fail("expected ',' or ']'");
+                        }
+                    }
+                }
+                case '{':
+                {
+                    ++m_current;
+                    Dico dico;
+                    if(!end() && *m_current == '}')
+                    {
+                        ++m_current;
+                        return Atom(move(dico));
+                    }
+                    while(true)
+                    {
+                        if(end() || *m_current != '\"')
+                        {
+                            fail("expected a key");
+                        }
+                        sTag key = readTag();
+                        if(end() || *m_current++ != ':')
+                        {
+                            fail("expected ':'");
+                        }
+                        dico[key] = read(depth + 1);
+                        if(end())
+                        {
+                            fail("unterminated object");
+                        }
+                        if(*m_current++ == '}')
+                        {
+                            return Atom(move(dico));
+                        }
+                        else if(m_current[-1] != ',')
+                        {
+                            --m_current;
+                            fail("expected ',' or '}'");
+                        }
+                    }
+                }
+                default:
+                    if(readWord("true", 4))
+                    {
+                        return Atom(true);
+                    }
+                    else if(readWord("false", 5))
+                    {
+                        return Atom(false);
+                    }
+                    else if(readWord("null", 4))
+                    {
+                        return Atom();
+                    }
+                    return readNumber();
+            }
+        }
+    };
+    
+    Atom Atom::fromJson(string_view text)
+    {
+        JsonReader reader(text);
+        Atom atom = reader.read();
+        if(!reader.end())
+        {
+            reader.fail("unexpected characters after the value");
+        }
+        return atom;
+    }
+    
     ostream& operator<<(ostream &output, const Atom &atom)
     {
         const bool boolalpha = output.flags() & ios::boolalpha;
@@ -176,16 +640,157 @@ namespace Kiwi
         return output;
     }
     
-    Vector Atom::parse(string const& text)
+    static bool isNumberWord(string_view word) noexcept
     {
-        Vector atoms;
-        const ulong textlen = text.length();
-        string::size_type pos = text.find_first_not_of(' ', 0);
+        bool isNumber   = false;
+        bool isFloat    = false;
+        bool isNegative = false;
+        for(string_view::size_type i = 0; i < word.size(); i++)
+        {
+            const char c = word[i];
+            if(i == 0 && c == '-')
+            {
+                isNegative = true;
+            }
+            else if(!isFloat && (i == 0 || isNumber || isNegative) && c == '.')
+            {
+                isFloat = true;
+            }
+            else if(isdigit(c) && (isNumber || (i == 0 || isNegative || isFloat)))
+            {
+                isNumber = true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return isNumber;
+    }
+    
+    static void toTextTag(string_view name, string& output)
+    {
+        bool quote = name.empty() || name[0] == '\"' || isNumberWord(name);
+        for(string_view::size_type i = 0; !quote && i < name.size(); i++)
+        {
+            const char c = name[i];
+            quote = c == ' ' || c == '\\' || c == '\n' || c == '\r' || c == '\"';
+        }
+        if(quote)
+        {
+            jsonEscape(name, output);
+        }
+        else
+        {
+            output.append(name.data(), name.size());
+        }
+    }
+    
+    void Atom::toText(Vector const& atoms, string& output)
+    {
+        char buffer[400];
+        for(Vector::size_type i = 0; i < atoms.size(); i++)
+        {
+            Atom const& atom = atoms[i];
+            if(i)
+            {
+                output += ' ';
+            }
+            if(atom.isBool())
+            {
+                output += atom.m_quark->getBool() ? '1' : '0';
+            }
+            else if(atom.isLong())
+            {
+                output.append(buffer, to_chars(buffer, buffer + sizeof(buffer), atom.m_quark->getLong()).ptr);
+            }
+            else if(atom.isDouble())
+            {
+                // the fixed notation because the parser doesn't read exponents
+                char* end = toCharsFixed(buffer, buffer + sizeof(buffer) - 1, atom.m_quark->getDouble());
+                if(isIntegral(buffer, end))
+                {
+                    *end++ = '.';
+                }
+                output.append(buffer, end);
+            }
+            else if(atom.isTag())
+            {
+                const sTag tag = atom.m_quark->getTag();
+                toTextTag(tag->getName(), output);
+            }
+            else if(atom.isVector() || atom.isDico())
+            {
+                ostringstream json;
+                json << atom;
+                jsonEscape(json.str(), output);
+            }
+        }
+    }
+    
+    string Atom::toText(Vector const& atoms)
+    {
+        string output;
+        toText(atoms, output);
+        return output;
+    }
+    
+    template <class Creator> static Atom createAtom(string_view word, const bool isNumber, const bool isFloat, Creator& create)
+    {
+        if(isNumber)
+        {
+            const Conversion<long> integer = isFloat ? Conversion<long>{0, errc::invalid_argument, nullptr} : fromChars<long>(word, true);
+            if(integer)
+            {
+                return Atom(integer.value);
+            }
+            else // floats and integers too large for a long
+            {
+                return Atom(fromChars<double>(word, true).value);
+            }
+        }
+        else if(jsonFindUnescape(word.data(), word.data() + word.size()) == word.data() + word.size())
+        {
+            // Without escape sequences nor quotes, the word is the name of the tag.
+            return Atom(create(word));
+        }
+        else
+        {
+            thread_local string name;
+            name.clear();
+            jsonUnescape(word, name);
+            return Atom(create(string_view(name)));
+        }
+    }
+    
+    static inline bool canBeClosed(const char* text, ulong pos, const ulong textlen)
+    {
+        for(; pos < textlen; pos++)
+        {
+            if(text[pos] == '\\')
+            {
+                pos++;
+            }
+            else if(text[pos] == '\"')
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    template <class Creator> static void parseRange(const char* text, const ulong textlen, Vector& atoms, Creator& create)
+    {
+        ulong pos = 0;
+        while(pos < textlen && text[pos] == ' ')
+        {
+            pos++;
+        }
         
+        string word;
         while(pos < textlen)
         {
-            string word;
-            word.reserve(20); // does it more efficient ?
+            word.clear();
             bool isTag      = false;
             bool isNumber   = false;
             bool isFloat    = false;
@@ -211,6 +816,14 @@ namespace Kiwi
                         }
                     }
                 }
+                else if(c == '\\' && isQuoted) // keep the escaped character for the unescaping
+                {
+                    word += c;
+                    if(++pos == textlen)
+                    {
+                        break;
+                    }
+                }
                 else if(c == '\"')
                 {
                     if(isQuoted) // closing quote
@@ -224,7 +837,7 @@ namespace Kiwi
                         pos++;
                         
                         // ignore if it can not be closed
-                        if(text.find_first_of('\"', pos) != string::npos)
+                        if(canBeClosed(text, pos, textlen))
                             isQuoted = isTag = true;
                         
                         continue;
@@ -251,31 +864,341 @@ namespace Kiwi
                     }
                 }
                 
-                word += c;
+                word += text[pos];
                 pos++;
             }
             
             if(!word.empty())
             {
-                if(isNumber)
+                atoms.push_back(createAtom(word, isNumber, isFloat, create));
+            }
+        }
+    }
+    
+    Vector Atom::parse(string const& text)
+    {
+        Vector atoms;
+        auto create = [](string_view name) {return Tag::create(name);};
+        parseRange(text.c_str(), text.length(), atoms, create);
+        return atoms;
+    }
+    
+    vector<Vector> Atom::parseLines(string const& text, const ulong nthreads)
+    {
+        vector<pair<ulong, ulong>> lines;
+        const ulong textlen = text.length();
+        const char* data = text.c_str();
+        for(ulong pos = 0; pos < textlen;)
+        {
+            const char* next = (const char *)memchr(data + pos, '\n', textlen - pos);
+            const ulong end = next ? ulong(next - data) : textlen;
+            lines.push_back(make_pair(pos, (end > pos && data[end - 1] == '\r') ? end - 1 : end));
+            pos = end + 1;
+        }
+        
+        vector<Vector> result(lines.size());
+        parallelFor(lines.size(), [&](const ulong begin, const ulong end)
+        {
+            // the workers only take the lock of the tags the first time they meet a name
+            unordered_map<string_view, sTag> tags;
+            auto create = [&tags](string_view name)
+            {
+                auto it = tags.find(name);
+                if(it != tags.end())
                 {
-                    if(isFloat)
-                    {
-                        atoms.push_back(Atom(stod(word.c_str())));
-                    }
-                    else
-                    {
-                        atoms.push_back(Atom(stol(word.c_str())));
-                    }
+                    return it->second;
+                }
+                sTag tag = Tag::create(name);
+                tags.emplace(tag->getName(), tag);
+                return tag;
+            };
+            for(ulong i = begin; i < end; i++)
+            {
+                parseRange(data + lines[i].first, lines[i].second - lines[i].first, result[i], create);
+            }
+        }, nthreads);
+        return result;
+    }
+    
+    vector<Vector> Atom::parseFile(string const& path, const ulong nthreads)
+    {
+        return parseLines(readFile(path), nthreads);
+    }
+    
+    // ================================================================================ //
+    //                                  ATOM PARSER                                     //
+    // ================================================================================ //
+    
+    Atom::Parser::Parser(Callback callback, const ulong maxsize) :
+    m_callback(callback),
+    m_max_size(maxsize),
+    m_overflow(false)
+    {
+        clear();
+    }
+    
+    void Atom::Parser::clear() noexcept
+    {
+        m_atoms.clear();
+        m_word.clear();
+        m_raw.clear();
+        m_size = 0ul;
+        m_tag = m_number = m_float = m_negative = m_quoted = m_escaped = m_return = m_discard = false;
+    }
+    
+    void Atom::Parser::write(const char* data, const ulong size)
+    {
+        for(ulong i = 0; i < size; i++)
+        {
+            receive(data[i]);
+        }
+        if(m_overflow)
+        {
+            m_overflow = false;
+            throw Error("The message exceeds the maximum size of " + toString(m_max_size) + " bytes");
+        }
+    }
+    
+    void Atom::Parser::flush()
+    {
+        receive('\n');
+    }
+    
+    void Atom::Parser::endWord()
+    {
+        if(!m_word.empty())
+        {
+            auto create = [](string_view name) {return Tag::create(name);};
+            m_atoms.push_back(createAtom(m_word, m_number, m_float, create));
+            m_word.clear();
+        }
+        m_tag = m_number = m_float = m_negative = m_quoted = m_escaped = false;
+    }
+    
+    void Atom::Parser::receive(const char c)
+    {
+        if(m_discard)
+        {
+            m_discard = c != '\n';
+            return;
+        }
+        if(c == '\n')
+        {
+            m_size = 0ul;
+        }
+        else if(++m_size > m_max_size)
+        {
+            clear();
+            m_discard = m_overflow = true;
+            return;
+        }
+        
+        // like in parseLines, a carriage return is only removed before a new line, otherwise it is an ordinary character
+        if(m_return)
+        {
+            m_return = false;
+            if(c != '\n')
+            {
+                tokenize('\r');
+            }
+        }
+        if(c == '\r')
+        {
+            m_return = true;
+        }
+        else
+        {
+            tokenize(c);
+        }
+    }
+    
+    void Atom::Parser::tokenize(const char c)
+    {
+        if(m_quoted)
+        {
+            if(c == '\n') // the quote can't be closed so it is ignored and the text is parsed again
+            {
+                string raw;
+                swap(raw, m_raw);
+                m_word.clear();
+                m_tag = m_quoted = m_escaped = false;
+                for(auto it : raw)
+                {
+                    tokenize(it);
+                }
+                tokenize(c);
+            }
+            else
+            {
+                m_raw += c;
+                if(m_escaped)
+                {
+                    m_escaped = false;
+                }
+                else if(c == '\\')
+                {
+                    m_escaped = true;
+                }
+                else if(c == '\"') // closing quote
+                {
+                    m_raw.clear();
+                    endWord();
+                    return;
+                }
+                m_word += c;
+            }
+        }
+        else if(c == '\n')
+        {
+            endWord();
+            if(!m_atoms.empty())
+            {
+                Vector atoms;
+                swap(atoms, m_atoms);
+                m_callback(atoms);
+            }
+        }
+        else if(c == ' ')
+        {
+            endWord();
+        }
+        else if(c == '\"' && m_word.empty()) // begin quote
+        {
+            m_quoted = m_tag = true;
+        }
+        else
+        {
+            if(!m_tag && c != '\"')
+            {
+                if(m_word.empty() && c == '-')
+                {
+                    m_negative = true;
+                }
+                else if(!m_float && (m_word.empty() || m_number || m_negative) && c == '.')
+                {
+                    m_float = true;
+                }
+                else if(isdigit(c) && (m_number || (m_word.empty() || m_negative || m_float)))
+                {
+                    m_number = true;
                 }
                 else
                 {
-                    atoms.push_back(Atom(Tag::create(jsonUnescape(word))));
+                    m_tag = true;
+                    m_number = m_negative = m_float = false;
                 }
             }
+            m_word += c;
         }
-        
-        return atoms;
+    }
+    
+    // ================================================================================ //
+    //                                  ATOM CACHE                                      //
+    // ================================================================================ //
+    
+    void Atom::Cache::begin()
+    {
+        if(m_starts.empty())
+        {
+            m_text.clear();
+            m_offset    = 0ul;
+            m_position  = 0ul;
+            m_first     = 0ul;
+        }
+        m_starts.push_back(m_position);
+    }
+    
+    void Atom::Cache::end(const uint64_t key, const uint64_t hash, const uint64_t check, const ulong indent, const ulong size)
+    {
+        const ulong start = m_starts.back();
+        m_starts.pop_back();
+        if(start >= m_offset && m_position - start <= m_max_size)
+        {
+            // the subtree is the last text written
+            Entry& entry = m_entries[key];
+            entry.generation    = m_generation;
+            entry.hash          = hash;
+            entry.check         = check;
+            entry.indent        = indent;
+            entry.size          = size;
+            entry.text.assign(m_text, start - m_offset, string::npos);
+        }
+        m_first = min(m_first, ulong(m_starts.size()));
+        release();
+    }
+    
+    void Atom::Cache::append(const char* text, const ulong size)
+    {
+        m_position += size;
+        if(m_first < m_starts.size())
+        {
+            m_text.append(text, size);
+            if(m_position - m_starts[m_first] > m_max_size)
+            {
+                release();
+            }
+        }
+        else
+        {
+            m_offset = m_position;
+        }
+    }
+    
+    void Atom::Cache::release() noexcept
+    {
+        // the subtrees are nested, so the first ones are the largest and they are the first ones that can't be stored
+        while(m_first < m_starts.size() && m_position - m_starts[m_first] > m_max_size)
+        {
+            m_first++;
+        }
+        if(m_first == m_starts.size())
+        {
+            m_text.clear();
+            m_offset = m_position;
+        }
+        else if(m_starts[m_first] - m_offset > m_text.size() / 2ul)
+        {
+            m_text.erase(0ul, m_starts[m_first] - m_offset);
+            m_offset = m_starts[m_first];
+        }
+    }
+    
+    string const* Atom::Cache::find(const uint64_t key, const uint64_t hash, const uint64_t check, const ulong indent, const ulong size) noexcept
+    {
+        // the second hash is computed with another function, so a collision of the content hashes doesn't return the text of another subtree
+        auto it = m_entries.find(key);
+        if(it != m_entries.end() && it->second.hash == hash && it->second.check == check && it->second.indent == indent && it->second.size == size)
+        {
+            it->second.generation = m_generation;
+            return &it->second.text;
+        }
+        return nullptr;
+    }
+    
+    ulong Atom::Cache::getNumberOfBytes() const noexcept
+    {
+        ulong bytes = 0ul;
+        for(auto const& it : m_entries)
+        {
+            bytes += ulong(it.second.text.size());
+        }
+        return bytes;
+    }
+    
+    void Atom::Cache::purge() noexcept
+    {
+        for(auto it = m_entries.begin(); it != m_entries.end();)
+        {
+            if(it->second.generation != m_generation)
+            {
+                it = m_entries.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        m_generation++;
     }
 }
 
@@ -39,6 +39,8 @@ namespace Kiwi
     class Atom
     {
     public:
+        class Parser;
+        class Cache;
         
         enum Type
         {
@@ -125,7 +127,9 @@ namespace Kiwi
         {
         public:
             Vector val;
-            inline QuarkVector(QuarkVector const& _val) noexcept : val(_val.val) {}
+            mutable atomic<uint64_t> hash {0ull};
+            mutable atomic<uint64_t> check {0ull};
+            inline QuarkVector(QuarkVector const& _val) noexcept : val(_val.val), hash(_val.hash.load(memory_order_relaxed)), check(_val.check.load(memory_order_relaxed)) {}
             inline QuarkVector(Vector const& _val) noexcept : val(_val) {}
             inline QuarkVector(Vector::iterator first, Vector::iterator last) noexcept : val(first, last) {}
             inline QuarkVector(Vector&& _val) noexcept {swap(val, _val);}
@@ -139,7 +143,9 @@ namespace Kiwi
         {
         public:
             Dico val;
-            inline QuarkDico(QuarkDico const& _val) noexcept : val(_val.val) {}
+            mutable atomic<uint64_t> hash {0ull};
+            mutable atomic<uint64_t> check {0ull};
+            inline QuarkDico(QuarkDico const& _val) noexcept : val(_val.val), hash(_val.hash.load(memory_order_relaxed)), check(_val.check.load(memory_order_relaxed)) {}
             inline QuarkDico(Dico const& _val) noexcept : val(_val) {}
             inline QuarkDico(Dico::iterator first, Dico::iterator last) noexcept : val(first, last) {}
             inline QuarkDico(Dico&& _val) noexcept {swap(val, _val);}
@@ -151,6 +157,12 @@ namespace Kiwi
         
         Quark* m_quark;
         
+        //! Retrieves the content hash and a second hash computed with another function, the cache compares the second one to verify its entries.
+        uint64_t getHash(uint64_t& check) const noexcept;
+        
+        static void writeJson(ostream &output, const Atom &atom, ulong& indent, Cache* cache);
+        static void writeJsonTree(ostream &output, const Atom &atom, ulong& indent, Cache* cache);
+        
     public:
         
         // ================================================================================ //
@@ -220,11 +232,23 @@ namespace Kiwi
          */
         inline Atom(string&& tag) noexcept : m_quark(new QuarkTag(Tag::create(forward<string>(tag)))) {}
         
+        //! Constructor with a string.
+        /** The function allocates the atom with a tag created with a view of a string.
+         @param tag The tag.
+         */
+        inline Atom(string_view tag) noexcept : m_quark(new QuarkTag(Tag::create(tag))) {}
+        
         //! Constructor with a tag.
         /** The function allocates the atom with a tag.
          */
         inline Atom(const sTag tag) noexcept : m_quark(new QuarkTag(tag)) {}
         
+        //! Constructor with a tag literal.
+        /** The function allocates the atom with the tag of a literal, so the members of Tags can be used like tags, for example Atom atom = Tags::set.
+         @param tag The tag literal.
+         */
+        inline Atom(Tag::Literal const& tag) noexcept : m_quark(new QuarkTag(Tag::create(tag))) {}
+        
         //! Constructor with a vector of atoms.
         /** The function allocates the atom with a vector of atoms.
          */
@@ -378,6 +402,26 @@ namespace Kiwi
          */
         inline operator Dico() const noexcept {return m_quark->getDico();}
         
+        //! Retrieves the vector of atoms.
+        /** The function retrieves the vector of atoms held by the atom without copying it, the reference remains valid until the atom is modified or destroyed.
+         @return The vector of atoms if the atom is a vector otherwise an empty vector.
+         */
+        inline Vector const& getVector() const noexcept
+        {
+            static const Vector empty;
+            return isVector() ? static_cast<QuarkVector const*>(m_quark)->val : empty;
+        }
+        
+        //! Retrieves the map of atoms.
+        /** The function retrieves the map of atoms held by the atom without copying it, the reference remains valid until the atom is modified or destroyed.
+         @return The map of atoms if the atom is a dico otherwise an empty map.
+         */
+        inline Dico const& getDico() const noexcept
+        {
+            static const Dico empty;
+            return isDico() ? static_cast<QuarkDico const*>(m_quark)->val : empty;
+        }
+        
         //! Set up the atom with another atom.
         /** The function sets up the atom with another atom.
          @param other   The other atom.
@@ -504,6 +548,18 @@ namespace Kiwi
             return *this;
         }
         
+        //! Set up the atom with a tag literal.
+        /** The function sets up the atom with the tag of a literal.
+         @param tag   The tag literal.
+         @return An atom.
+         */
+        inline Atom& operator=(Tag::Literal const& tag) noexcept
+        {
+            delete m_quark;
+            m_quark = new QuarkTag(Tag::create(tag));
+            return *this;
+        }
+        
         //! Set up the atom with a vector of atoms.
         /** The function sets up the atom with a vector of atoms.
          @param atoms   The vector of atoms.
@@ -705,14 +761,14 @@ namespace Kiwi
         //! Compare the atom with a string.
         /** The function compares the atom with a string.
          @param tag   The string.
-         @return true if the atom hold the same tag create with the string otherwise false.
+         @return true if the atom hold a tag with the same name otherwise false.
          */
         bool operator==(char const* tag) const noexcept;
         
         //! Compare the atom with a string.
         /** The function compares the atom with a string.
          @param tag   The string.
-         @return true if the atom hold the same tag create with the string otherwise false.
+         @return true if the atom hold a tag with the same name otherwise false.
          */
         bool operator==(string const& tag) const noexcept;
         
@@ -723,6 +779,16 @@ namespace Kiwi
          */
         bool operator==(sTag tag) const noexcept;
         
+        //! Compare the atom with a tag literal.
+        /** The function compares the atom with a tag literal, the hash of the literal is computed at compile time so the comparison doesn't look up the tag.
+         @param tag   The tag literal.
+         @return true if the atom hold the tag of the literal otherwise false.
+         */
+        inline bool operator==(Tag::Literal const& tag) const noexcept
+        {
+            return isTag() && m_quark->getTag() == tag;
+        }
+        
         //! Compare the atom with a vector.
         /** The function compares the atom with a vector.
          @param vector   The vector.
@@ -827,6 +893,16 @@ namespace Kiwi
             return !(*this == tag);
         }
         
+        //! Compare the atom with a tag literal.
+        /** The function compares the atom with a tag literal.
+         @param tag   The tag literal.
+         @return true if the atom differ from the tag of the literal otherwise false.
+         */
+        inline bool operator!=(Tag::Literal const& tag) const noexcept
+        {
+            return !(*this == tag);
+        }
+        
         //! Compare the atom with a vector.
         /** The function compares the atom with a vector.
          @param vector   The vector.
@@ -847,8 +923,39 @@ namespace Kiwi
             return !(*this == dico);
         }
         
+        //! Retrieve the content hash of the atom.
+        /** The function retrieves a hash of the type and the value of the atom that depends neither on the addresses of the tags nor on the run, so equal atoms have the same hash from one session to another. The hashes of the vectors and the dicos are computed once and kept with their values.
+         @return The hash.
+         */
+        uint64_t getHash() const noexcept;
+        
+        //! Write an atom in json.
+        /** The function writes an atom in json.
+         @param output  The stream.
+         @param atom    The atom.
+         @param indent  The current indentation.
+         @return The stream.
+         */
         static ostream& toJson(ostream &output, const Atom &atom, ulong& indent);
         
+        //! Write an atom in json reusing the text of the unchanged vectors and dicos.
+        /** The function writes an atom in json like the other toJson function does but looks up the vectors and the dicos in a cache by their content hash and indentation. The text of a subtree found in the cache is copied as it is, the text of the others is written and stored in the cache.
+         @param output  The stream.
+         @param atom    The atom.
+         @param indent  The current indentation.
+         @param cache   The cache.
+         @return The stream.
+         */
+        static ostream& toJson(ostream &output, const Atom &atom, ulong& indent, Cache& cache);
+        
+        //! Read an atom from json.
+        /** The function reads an atom from a json text like the one written by the toJson function. The strings become tags, the numbers with a fraction or an exponent become doubles and the others longs, the arrays become vectors, the objects dicos and null an undefined atom.
+         @param     text    The json text.
+         @return    The atom.
+         @exception Error if the text isn't valid json.
+         */
+        static Atom fromJson(string_view text);
+        
         //! Parse a string into a vector of atoms.
         /** Parse a string into a vector of atoms.
          @param     text	The string to parse.
@@ -857,6 +964,194 @@ namespace Kiwi
          The atom types will be determined automatically as 2 #Atom::Type::TAG atoms, 2 #Atom::Type::LONG atoms, and 1 #Atom::Type::DOUBLE atom.
          */
         static Vector parse(string const& text);
+
+        //! Format a vector of atoms into a text.
+        /** The function appends the atoms to a text separated by spaces, in the form read by the parse function. The tags are quoted and escaped only when needed and the numbers are written in the shortest fixed notation that reads back to the same value, so parsing the text gives back the same atoms. The booleans are written as 0 or 1, the vectors and the dicos are written in json as quoted tags.
+         @param     atoms   The vector of atoms.
+         @param     output  The text, it can be reused between calls to avoid allocations.
+         @remark    The empty tags, the infinite and the nan values can't be parsed back.
+         */
+        static void toText(Vector const& atoms, string& output);
+        
+        //! Format a vector of atoms into a text.
+        /** The function formats the atoms into a text like the other toText function does.
+         @param     atoms   The vector of atoms.
+         @return    The text.
+         */
+        static string toText(Vector const& atoms);
+        
+        //! Parse a multi-line text into vectors of atoms.
+        /** The function splits the text at the line boundaries and parses each line into a vector of atoms like the parse function does. The lines are parsed on several threads and the tags are interned through a cache local to each thread so the workers rarely wait for each other.
+         @param     text        The text to parse.
+         @param     nthreads    The maximum number of threads, zero means the number of hardware threads.
+         @return    The vectors of atoms, one for each line of the text and in the same order.
+         */
+        static vector<Vector> parseLines(string const& text, const ulong nthreads = 0ul);
+
+        //! Parse a multi-line text file into vectors of atoms.
+        /** The function reads the whole file and parses it with the parseLines function.
+         @param     path        The path of the file.
+         @param     nthreads    The maximum number of threads, zero means the number of hardware threads.
+         @return    The vectors of atoms, one for each line of the file and in the same order.
+         @exception Error if the file can't be read.
+         */
+        static vector<Vector> parseFile(string const& path, const ulong nthreads = 0ul);
+    };
+    
+    // ================================================================================ //
+    //                                  ATOM PARSER                                     //
+    // ================================================================================ //
+    
+    //! The atom parser parses a text that arrives by chunks.
+    /** The parser receives a text by chunks of any size, for example from a socket or a pipe, and sends each complete message to a callback. A message is a line of text parsed like the Atom::parse function does. The state of the tokenizer, including the open quotes and the escape sequences, is kept between the chunks so a tag can be split anywhere. The parser only holds the current message, so its memory doesn't depend on the length of the stream.
+     */
+    class Atom::Parser
+    {
+    public:
+        typedef function<void(Vector&)> Callback;
+        
+    private:
+        const Callback  m_callback;
+        const ulong     m_max_size;
+        Vector          m_atoms;
+        string          m_word;
+        string          m_raw;
+        ulong           m_size;
+        bool            m_discard;
+        bool            m_overflow;
+        bool            m_tag;
+        bool            m_number;
+        bool            m_float;
+        bool            m_negative;
+        bool            m_quoted;
+        bool            m_escaped;
+        bool            m_return;
+        
+        void receive(const char c);
+        void tokenize(const char c);
+        void endWord();
+        
+    public:
+        
+        //! Constructor.
+        /** Creates a parser. The size of the messages is limited so the memory used by the parser stays bounded whatever the stream, a message that exceeds the limit is discarded up to its new line.
+         @param callback The function that receives the messages, it can move the atoms out of the vector.
+         @param maxsize  The maximum size of a message in bytes.
+         */
+        Parser(Callback callback, const ulong maxsize = 1048576ul);
+        
+        //! Destructor.
+        /** The pending message is discarded, call flush before if you want to receive it.
+         */
+        inline ~Parser() noexcept {}
+        
+        //! Parses a chunk of text.
+        /** The function parses a chunk of text and sends the messages that have been completed to the callback. If a message exceeds the maximum size, the whole chunk is parsed then the function throws an Error, the rest of the message is discarded up to its new line.
+         @param data The chunk of text.
+         @param size The size of the chunk.
+         */
+        void write(const char* data, const ulong size);
+        
+        //! Parses a chunk of text.
+        /** The function parses a chunk of text and sends the messages that have been completed to the callback.
+         @param text The chunk of text.
+         */
+        inline void write(string const& text) {write(text.data(), text.size());}
+        
+        //! Completes the pending message.
+        /** The function ends the pending message as if a new line had been received, for example at the end of the stream.
+         */
+        void flush();
+        
+        //! Discards the pending message.
+        /** The function discards the pending message and resets the state of the tokenizer.
+         */
+        void clear() noexcept;
+    };
+    
+    // ================================================================================ //
+    //                                  ATOM CACHE                                      //
+    // ================================================================================ //
+    
+    //! The atom cache keeps the json text of vectors and dicos.
+    /** The cache associates the content hashes of vectors and dicos and the state of the stream with their json text, so a save pass only formats the subtrees that changed since the previous one. An entry is found by the content hash, the indentation and the number of elements of its subtree, it doesn't keep the atom. The small vectors of numbers and tags are formatted each time, they are cheaper to write than to look up. The subtrees that aren't found are written directly to the stream while their text is copied to the cache. Call purge after each pass to remove the entries that haven't been used.
+     An entry also keeps a second 64 bits hash of its subtree computed with another function, a hit requires both hashes to match. Two different subtrees would have to collide on 128 bits of hash with the same indentation and number of elements to share an entry, the risk is negligible but not zero.
+     @see Atom::toJson
+     */
+    class Atom::Cache
+    {
+    private:
+        friend Atom;
+        class Capture;
+        
+        struct Entry
+        {
+            ulong       generation;
+            uint64_t    hash;
+            uint64_t    check;
+            ulong       indent;
+            ulong       size;
+            string      text;
+        };
+        
+        unordered_map<uint64_t, Entry> m_entries;
+        const function<uint64_t(Atom const&)> m_hash;
+        ulong                   m_generation;
+        const ulong             m_max_size;
+        string                  m_text;
+        ulong                   m_offset;
+        ulong                   m_position;
+        vector<ulong>           m_starts;
+        ulong                   m_first;
+        
+        //! Starts the text of a subtree, the text written to the stream is kept from now on.
+        void begin();
+        
+        //! Ends the text of a subtree and adds it to the cache if it isn't too large.
+        void end(const uint64_t key, const uint64_t hash, const uint64_t check, const ulong indent, const ulong size);
+        
+        //! Copies the text written to the stream.
+        void append(const char* text, const ulong size);
+        
+        //! Releases the text that the subtrees being written don't need anymore.
+        void release() noexcept;
+        
+    public:
+        
+        //! Constructor.
+        /** Creates an empty cache.
+         @param maxsize The maximum size of the text of an entry, the larger subtrees are formatted each time.
+         @param hash    The function that replaces the content hash of the subtrees, for the tests, or nullptr.
+         */
+        inline Cache(const ulong maxsize = 1048576ul, function<uint64_t(Atom const&)> hash = nullptr) noexcept : m_hash(move(hash)), m_generation(0ul), m_max_size(maxsize), m_offset(0ul), m_position(0ul), m_first(0ul) {}
+        
+        //! Destructor.
+        inline ~Cache() noexcept {}
+        
+        //! Retrieves the text of an entry.
+        /** The function retrieves the text of an entry and marks the entry as used if the entry has the same hashes, indentation and number of elements.
+         @param key     The key of the entry, the content hash mixed with the state of the stream.
+         @param hash    The content hash of the subtree.
+         @param check   The second hash of the subtree.
+         @param indent  The indentation of the subtree.
+         @param size    The number of elements of the subtree.
+         @return The text or nullptr if the entry doesn't exist or holds another subtree.
+         */
+        string const* find(const uint64_t key, const uint64_t hash, const uint64_t check, const ulong indent, const ulong size) noexcept;
+        
+        //! Removes the entries that haven't been used.
+        /** The function removes the entries that haven't been used since the previous call.
+         */
+        void purge() noexcept;
+        
+        //! Removes all the entries.
+        inline void clear() noexcept {m_entries.clear();}
+        
+        //! Retrieves the number of entries.
+        inline ulong size() const noexcept {return ulong(m_entries.size());}
+        
+        //! Retrieves the number of bytes of the text of the entries.
+        ulong getNumberOfBytes() const noexcept;
     };
     
     ostream& operator<<(ostream &output, const Atom &atom);
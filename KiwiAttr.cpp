@@ -31,14 +31,158 @@ namespace Kiwi
     
     void Attr::Manager::write(Dico& dico) const
     {
-        ;
+        lock_guard<mutex> guard(m_attrs_mutex);
+        for(auto it : m_attrs)
+        {
+            if(!it.second->isUnsaved())
+            {
+                dico[it.first] = it.second->getValue();
+            }
+        }
+    }
+    
+    bool Attr::Manager::writeChanges(Dico& dico)
+    {
+        lock_guard<mutex> guard(m_attrs_mutex);
+        for(auto name : m_changes)
+        {
+            const auto it = m_attrs.find(name);
+            if(it != m_attrs.end() && !it->second->isUnsaved())
+            {
+                dico[name] = it->second->getValue();
+            }
+        }
+        const bool changed = !m_changes.empty();
+        m_changes.clear();
+        return changed;
+    }
+    
+    bool Attr::Manager::hasChanges() const noexcept
+    {
+        lock_guard<mutex> guard(m_attrs_mutex);
+        return !m_changes.empty();
+    }
+    
+    void Attr::Manager::clearChanges() noexcept
+    {
+        lock_guard<mutex> guard(m_attrs_mutex);
+        m_changes.clear();
     }
     
     void Attr::Manager::read(Dico const& dico)
     {
-        for(auto it = dico.begin(); it != dico.end(); ++it)
+        vector<sAttr> changed;
+        decode(dico, changed);
+        sendChanges(changed);
+    }
+    
+    void Attr::Manager::decode(Dico const& dico, vector<sAttr>& changed)
+    {
+        const TagLess less;
+        lock_guard<mutex> guard(m_attrs_mutex);
+        auto attr = m_attrs.begin();
+        auto it = dico.begin();
+        while(attr != m_attrs.end() && it != dico.end())
+        {
+            if(less(attr->first, it->first))
+            {
+                ++attr;
+            }
+            else if(less(it->first, attr->first))
+            {
+                ++it;
+            }
+            else
+            {
+                if(attr->second->decode(it->second))
+                {
+                    changed.push_back(attr->second);
+                }
+                ++attr;
+                ++it;
+            }
+        }
+    }
+    
+    // The number of entries below which the managers are read on the calling thread, the chaining of the entries and the tasks cost more than the threads save.
+    static const ulong readParallelSize = 4096ul;
+    
+    void Attr::Manager::read(vector<pair<sManager, Dico const*>> const& managers, ulong nthreads)
+    {
+        const ulong size = managers.size();
+        if(!nthreads)
+        {
+            nthreads = ulong(thread::hardware_concurrency());
+        }
+        if(nthreads < 2ul || size < readParallelSize)
+        {
+            // The entries are read one after the other like the read of a single dico, so a manager is notified while it is still in the cache.
+            vector<sAttr> changed;
+            for(auto const& entry : managers)
+            {
+                if(entry.first && entry.second)
+                {
+                    changed.clear();
+                    entry.first->decode(*entry.second, changed);
+                    entry.first->sendChanges(changed);
+                }
+            }
+            return;
+        }
+        
+        // The entries of a manager are chained in the order of the vector and decoded one after the other by the same task.
+        vector<ulong> firsts;
+        vector<ulong> nexts(size, size);
+        unordered_map<Manager const*, ulong> lasts;
+        lasts.reserve(size);
+        for(ulong i = 0; i < size; i++)
+        {
+            if(managers[i].first && managers[i].second)
+            {
+                auto it = lasts.emplace(managers[i].first.get(), i);
+                if(it.second)
+                {
+                    firsts.push_back(i);
+                }
+                else
+                {
+                    nexts[it.first->second] = i;
+                    it.first->second = i;
+                }
+            }
+        }
+        
+        // The changes of a block are stored in a single vector, each entry keeps its block and its range.
+        vector<vector<sAttr>> changes(firsts.size());
+        vector<array<ulong, 3>> ranges(size, array<ulong, 3>{0ul, 0ul, 0ul});
+        parallelFor(firsts.size(), [&managers, &firsts, &nexts, &changes, &ranges, size](const ulong begin, const ulong end)
+        {
+            vector<sAttr>& changed = changes[begin];
+            for(ulong i = begin; i < end; i++)
+            {
+                for(ulong j = firsts[i]; j < size; j = nexts[j])
+                {
+                    const ulong start = changed.size();
+                    managers[j].first->decode(*managers[j].second, changed);
+                    ranges[j] = {begin, start, changed.size()};
+                }
+            }
+        }, nthreads);
+        
+        for(ulong i = 0; i < size; i++)
+        {
+            for(ulong j = ranges[i][1]; j < ranges[i][2]; j++)
+            {
+                managers[i].first->sendChange(changes[ranges[i][0]][j]);
+            }
+        }
+    }
+    
+    void Attr::Manager::sendChanges(vector<sAttr> const& changed)
+    {
+        for(auto attr : changed)
         {
-            setAttrValue(it->first, it->second);
+            sendChange(attr);
         }
     }
     
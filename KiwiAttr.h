@@ -86,6 +86,21 @@ namespace Kiwi
          */
         virtual inline void setValue(Atom const& atom) = 0;
         
+        //! Sets the attribute value with an atom if it differs.
+        /** The function sets the attribute value with an atom if it differs from the current one. The default implementation compares the atom with the current value, the typed attributes override it to convert the atom without building an atom of the current value.
+         @param atom The atom.
+         @return True if the value changed, otherwise false.
+         */
+        virtual inline bool decode(Atom const& atom)
+        {
+            if(getValue() != atom)
+            {
+                setValue(atom);
+                return true;
+            }
+            return false;
+        }
+        
         //! Freezes or unfreezes the current value.
         /** Freezes or unfreezes the current value.
          @param frozen If true the attribute will be frozen, if false it will be unfrozen.
@@ -357,6 +372,22 @@ namespace Kiwi
          */
         void setValue(Atom const& atom) override {m_value = atom;}
         
+        //! Sets the attribute value with an atom if it differs.
+        /** The function converts the atom and sets the value if it differs from the current one.
+         @param atom The atom.
+         @return True if the value changed, otherwise false.
+         */
+        bool decode(Atom const& atom) override
+        {
+            T value = atom;
+            if(m_value != value)
+            {
+                m_value = move(value);
+                return true;
+            }
+            return false;
+        }
+        
         //! Freezes or unfreezes the current value.
         /** Freezes or unfreezes the current value.
          @param frozen If true the attribute will be frozen, if false it will be unfrozen.
@@ -405,9 +436,39 @@ namespace Kiwi
     class Attr::Manager : public inheritable_enable_shared_from_this<Manager>
     {
     private:
-        map<sTag, sAttr>                m_attrs;
+        map<sTag, sAttr, TagLess>       m_attrs;
+        set<sTag, TagLess>              m_changes;
         mutable mutex                   m_attrs_mutex;
         
+        //! Marks an attribute as changed since the last checkpoint.
+        /** The function records the name of the attribute in the changes if the attribute is saved.
+         @param attr The attribute.
+         */
+        inline void setChanged(sAttr attr) noexcept
+        {
+            if(!attr->isUnsaved())
+            {
+                lock_guard<mutex> guard(m_attrs_mutex);
+                m_changes.insert(attr->getName());
+            }
+        }
+        
+        //! Sends the notification that an attribute has changed.
+        /** The function notifies the manager and the listeners of the attribute that its value has changed.
+         @param attr The attribute.
+         */
+        inline void sendChange(sAttr attr)
+        {
+            if(this->notify(attr))
+            {
+                vector<sListener> listeners(attr->getListeners());
+                for(auto it : listeners)
+                {
+                    it->attrChanged(shared_from_this(), attr);
+                }
+            }
+        }
+        
         //! Retrieves an attribute.
         /** The function retrieves an attribute.
          @param name the name of the attribute.
@@ -499,14 +560,8 @@ namespace Kiwi
                 if(attr->getValue() != atom)
                 {
                     attr->setValue(atom);
-                    if(this->notify(attr))
-                    {
-                        vector<sListener> listeners(attr->getListeners());
-                        for(auto it : listeners)
-                        {
-                            it->attrChanged(shared_from_this(), attr);
-                        }
-                    }
+                    setChanged(attr);
+                    sendChange(attr);
                 }
             }
         }
@@ -524,30 +579,63 @@ namespace Kiwi
                 if(attr->get() != value)
                 {
                     attr->set(value);
-                    if(this->notify(attr))
-                    {
-                        vector<sListener> listeners(attr->getListeners());
-                        for(auto it : listeners)
-                        {
-                            it->attrChanged(shared_from_this(), attr);
-                        }
-                    }
+                    setChanged(attr);
+                    sendChange(attr);
                 }
             }
 		}
         
         //! Write the attributes in a dico.
-        /** The function writes the attributes in a dico.
+        /** The function writes the values of the attributes that are saved in a dico.
          @param dico The dico.
+         @see writeChanges, clearChanges
          */
         void write(Dico& dico) const;
         
-        //! Write the attributes in a dico.
-        /** The function writes the attributes in a dico.
+        //! Write the attributes that changed in a dico.
+        /** The function writes the values of the saved attributes that changed since the last checkpoint in a dico and sets a new checkpoint. The save pass can then emit only the changes.
+         @param dico The dico.
+         @return True if any attribute changed, otherwise false.
+         */
+        bool writeChanges(Dico& dico);
+        
+        //! Retrieve if attributes changed.
+        /** The function retrieves if saved attributes changed since the last checkpoint.
+         @return True if any attribute changed, otherwise false.
+         */
+        bool hasChanges() const noexcept;
+        
+        //! Sets a checkpoint.
+        /** The function forgets the changes of the attributes, for example after a complete write or after a complete state has been read.
+         */
+        void clearChanges() noexcept;
+        
+        //! Read the attributes from a dico.
+        /** The function sets the values of the attributes from a dico. The values read aren't marked as changes and the changes marked before are kept, even if the dico holds the same values, so an edit that hasn't been written yet isn't lost. Call clearChanges after restoring a complete state. The dico and the attributes being ordered the same way, they are walked together under a single lock and the values are decoded directly into the attributes, then the listeners of the attributes that changed are notified.
          @param dico The dico.
          */
         void read(Dico const& dico);
         
+        //! Decode the attributes from a dico.
+        /** The function sets the values of the attributes from a dico like the read function does but doesn't notify the changes.
+         @param dico    The dico.
+         @param changed The vector that receives the attributes that changed.
+         */
+        void decode(Dico const& dico, vector<sAttr>& changed);
+        
+        //! Read the attributes of several managers.
+        /** The function decodes the dicos into their managers on several threads, then notifies the changes on the calling thread in the order of the vector and the attributes. The dicos of a manager that appears several times are decoded one after the other in the order of the vector by the same thread, so the last one wins, but its listeners are notified after all of them have been decoded. The dicos are only referred to, so they must stay alive during the call. Below a few thousands entries or with a single thread, the entries are read one after the other on the calling thread like the read of a single dico, the threads wouldn't pay for the dispatch, so a manager that appears several times is notified after each of its dicos.
+         @param managers    The managers and the dicos to read, the entries without manager or dico are ignored.
+         @param nthreads    The maximum number of threads, zero means the number of hardware threads.
+         */
+        static void read(vector<pair<sManager, Dico const*>> const& managers, ulong nthreads = 0ul);
+        
+        //! Notify the attributes changes.
+        /** The function notifies the manager and the listeners of the attributes that their values have changed, in the order of the vector.
+         @param changed The attributes that changed.
+         */
+        void sendChanges(vector<sAttr> const& changed);
+        
         //! Add an attribute listener in the binding list of the attribute manager.
         /** The function adds an attribute listener in the binding list of the attribute manager. The attribute listener can specifies the names of the attributes, an empty vector means it will be attached to all the attributes.
          @param listener  The listener.
@@ -31,6 +31,9 @@
 #include "KiwiAttr.h"
 #include "KiwiBroadcaster.h"
 #include "KiwiListenerSet.h"
+#include "KiwiWriter.h"
+#include "KiwiWire.h"
+#include "KiwiLoader.h"
 
 #endif
 
@@ -0,0 +1,266 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiLoader.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                      LOADER                                      //
+    // ================================================================================ //
+    
+    static inline bool isJsonSpace(const char c) noexcept
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+    
+    Loader::Loader(const ulong chunksize) noexcept :
+    m_chunk_size(max(chunksize, 1ul)),
+    m_cancel(false),
+    m_read(0ul),
+    m_size(0ul),
+    m_sections(0ul)
+    {
+        ;
+    }
+    
+    Loader::~Loader()
+    {
+        m_cancel = true;
+        if(m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+    
+    future<Dico> Loader::load(string const& path, Callback callback)
+    {
+        m_cancel = true;
+        if(m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        m_cancel    = false;
+        m_read      = 0ul;
+        m_size      = 0ul;
+        m_sections  = 0ul;
+        promise<Dico> result;
+        future<Dico> future = result.get_future();
+        m_thread = thread(&Loader::run, this, path, callback, move(result));
+        return future;
+    }
+    
+    void Loader::run(string path, Callback callback, promise<Dico> result)
+    {
+        try
+        {
+            ifstream file(path, ios::in | ios::binary);
+            if(!file.is_open())
+            {
+                throw Error("Can't open the file " + path);
+            }
+            file.seekg(0, ios::end);
+            const streamoff size = file.tellg();
+            m_size = size > 0 ? ulong(size) : 0ul;
+            file.seekg(0, ios::beg);
+            
+            Dico dico;
+            string text;
+            string name;
+            vector<char> chunk(m_chunk_size);
+            string::size_type position = 0, start = 0;
+            // the brackets opened and not closed yet, so a bracket closed by the other one is an error
+            string brackets;
+            bool started = false, finished = false, quoted = false, escaped = false;
+            
+            // Decodes a member of the top-level object, its text is between the start and the position.
+            auto section = [&]()
+            {
+                const char* first = text.data() + start;
+                const char* last  = text.data() + position;
+                while(first != last && isJsonSpace(*first))
+                {
+                    ++first;
+                }
+                if(first == last && finished && dico.empty())
+                {
+                    return;
+                }
+                if(first == last || *first != '\"')
+                {
+                    throw Error("Invalid json in the file " + path + " : expected a key");
+                }
+                const char* key = ++first;
+                while(true)
+                {
+                    first = jsonFindUnescape(first, last);
+                    if(first == last || *first == '\"')
+                    {
+                        break;
+                    }
+                    first = min(first + 2, last);
+                }
+                name.clear();
+                jsonUnescape(string_view(key, size_t(first - key)), name);
+                if(first != last)
+                {
+                    ++first;
+                }
+                while(first != last && isJsonSpace(*first))
+                {
+                    ++first;
+                }
+                if(first == last || *first != ':')
+                {
+                    throw Error("Invalid json in the file " + path + " : expected ':'");
+                }
+                const sTag tag = Tag::create(name);
+                Atom& value = dico[tag];
+                value = Atom::fromJson(string_view(first + 1, size_t(last - first - 1)));
+                m_sections++;
+                if(callback)
+                {
+                    callback(tag, value);
+                }
+            };
+            
+            while(true)
+            {
+                if(m_cancel)
+                {
+                    throw Error("The loading of the file " + path + " has been cancelled");
+                }
+                file.read(chunk.data(), streamsize(chunk.size()));
+                const streamsize count = file.gcount();
+                if(count <= 0)
+                {
+                    if(file.bad())
+                    {
+                        throw Error("Can't read the file " + path);
+                    }
+                    break;
+                }
+                text.append(chunk.data(), size_t(count));
+                m_read += ulong(count);
+                
+                for(; position < text.size(); ++position)
+                {
+                    const char c = text[position];
+                    if(quoted)
+                    {
+                        if(escaped)
+                        {
+                            escaped = false;
+                        }
+                        else if(c == '\\')
+                        {
+                            escaped = true;
+                        }
+                        else if(c == '\"')
+                        {
+                            quoted = false;
+                        }
+                        else
+                        {
+                            position = string::size_type(jsonFindUnescape(text.data() + position, text.data() + text.size()) - text.data()) - 1;
+                        }
+                    }
+                    else if(finished)
+                    {
+                        if(!isJsonSpace(c))
+                        {
+                            throw Error("Invalid json in the file " + path + " : unexpected characters after the object");
+                        }
+                    }
+                    else if(!started)
+                    {
+                        if(c == '{')
+                        {
+                            started = true;
+                            brackets.push_back('}');
+                            start   = position + 1;
+                        }
+                        else if(!isJsonSpace(c))
+                        {
+                            throw Error("Invalid json in the file " + path + " : expected an object");
+                        }
+                    }
+                    else if(c == '\"')
+                    {
+                        quoted = true;
+                    }
+                    else if(c == '{' || c == '[')
+                    {
+                        brackets.push_back(c == '{' ? '}' : ']');
+                    }
+                    else if(c == '}' || c == ']')
+                    {
+                        if(brackets.back() != c)
+                        {
+                            throw Error("Invalid json in the file " + path + " : mismatched '" + c + "'");
+                        }
+                        brackets.pop_back();
+                        if(brackets.empty())
+                        {
+                            finished = true;
+                            section();
+                        }
+                    }
+                    else if(c == ',' && brackets.size() == 1ul)
+                    {
+                        section();
+                        start = position + 1;
+                        if(m_cancel)
+                        {
+                            throw Error("The loading of the file " + path + " has been cancelled");
+                        }
+                    }
+                }
+                
+                // Only the text of the current member is kept.
+                if(finished)
+                {
+                    text.clear();
+                    position = start = 0;
+                }
+                else if(start)
+                {
+                    text.erase(0, start);
+                    position -= start;
+                    start = 0;
+                }
+            }
+            if(!finished)
+            {
+                throw Error("Unexpected end of the file " + path);
+            }
+            result.set_value(move(dico));
+        }
+        catch(...)
+        {
+            result.set_exception(current_exception());
+        }
+    }
+}
+
+
@@ -0,0 +1,109 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#ifndef __DEF_KIWI_LOADER__
+#define __DEF_KIWI_LOADER__
+
+#include "KiwiAtom.h"
+#include <future>
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                      LOADER                                      //
+    // ================================================================================ //
+    
+    //! The loader reads a json file in the background.
+    /** The loader reads a json file by chunks on a background thread and decodes each member of the top-level object as soon as its text is complete. The sections are sent to a callback while the rest of the file is still being read, so the objects of a patch can be created before the whole file has been loaded, and the complete dico is available through a future. The loading can be cancelled and its progress can be polled from any thread.
+     */
+    class Loader
+    {
+    public:
+        typedef function<void(sTag, Atom&)> Callback;
+    
+    private:
+        const ulong         m_chunk_size;
+        thread              m_thread;
+        atomic_bool         m_cancel;
+        atomic<ulong>       m_read;
+        atomic<ulong>       m_size;
+        atomic<ulong>       m_sections;
+        
+        //! The function of the background thread.
+        void run(string path, Callback callback, promise<Dico> result);
+    
+    public:
+    
+        //! Constructor.
+        /** Creates a loader.
+         @param chunksize The size of the chunks read from the file in bytes.
+         */
+        Loader(const ulong chunksize = 65536ul) noexcept;
+        
+        //! Destructor.
+        /** Cancels the loading and waits for the background thread.
+         */
+        ~Loader();
+        
+        //! Starts to load a file.
+        /** The function cancels the current loading and starts to load a file on the background thread. The callback is called on the background thread, once for each member of the top-level object and in the order of the file.
+         @param path        The path of the file.
+         @param callback    The function that receives the sections, it can be empty.
+         @return The future of the top-level dico, it holds an Error if the file can't be read, isn't valid json or if the loading has been cancelled.
+         */
+        future<Dico> load(string const& path, Callback callback = nullptr);
+        
+        //! Cancels the loading.
+        /** The function asks the background thread to stop, it stops before the next section or chunk.
+         */
+        inline void cancel() noexcept {m_cancel = true;}
+        
+        //! Retrieves the number of bytes read.
+        /** The function retrieves the number of bytes read from the file.
+         @return The number of bytes read.
+         */
+        inline ulong getBytesRead() const noexcept {return m_read;}
+        
+        //! Retrieves the size of the file.
+        /** The function retrieves the size of the file, it is zero until the file has been opened.
+         @return The size of the file in bytes.
+         */
+        inline ulong getSize() const noexcept {return m_size;}
+        
+        //! Retrieves the progress of the loading.
+        /** The function retrieves the part of the file that has been read.
+         @return The progress between 0 and 1.
+         */
+        inline double getProgress() const noexcept {const ulong size = m_size; return size ? double(m_read) / double(size) : 0.;}
+        
+        //! Retrieves the number of sections decoded.
+        /** The function retrieves the number of members of the top-level object that have been decoded.
+         @return The number of sections.
+         */
+        inline ulong getNumberOfSections() const noexcept {return m_sections;}
+    };
+}
+
+#endif
+
+
@@ -23,90 +23,844 @@
 
 
 #include "KiwiTag.h"
+#include "KiwiAtom.h"
 
 namespace Kiwi
 {    
-    map<string, sTag> Tag::m_tags;
-    mutex Tag::m_mutex;
-    
-    const sTag Tags::_empty                = Tag::create("");
-    const sTag Tags::arguments             = Tag::create("arguments");
-    const sTag Tags::Arial                 = Tag::create("Arial");
-    
-    const sTag Tags::bang                  = Tag::create("bang");
-    const sTag Tags::bdcolor               = Tag::create("bdcolor");
-    const sTag Tags::bgcolor               = Tag::create("bgcolor");
-    const sTag Tags::bold                  = Tag::create("bold");
-    const sTag Tags::bold_italic           = Tag::create("bold italic");
-    
-    const sTag Tags::center                = Tag::create("center");
-    const sTag Tags::color                 = Tag::create("color");
-    const sTag Tags::Color                 = Tag::create("Color");
-    const sTag Tags::command               = Tag::create("command");
-    const sTag Tags::circlecolor           = Tag::create("circlecolor");
-    
-    const sTag Tags::dsp                   = Tag::create("dsp");
-    
-    const sTag Tags::from                  = Tag::create("from");
-    const sTag Tags::focus                 = Tag::create("focus");
-    const sTag Tags::font                  = Tag::create("font");
-    const sTag Tags::Font                  = Tag::create("Font");
-    const sTag Tags::Font_Face             = Tag::create("Font Face");
-    const sTag Tags::Font_Justification    = Tag::create("Font Justification");
-    const sTag Tags::Font_Name             = Tag::create("Font Name");
-    const sTag Tags::Font_Size             = Tag::create("Font Size");
-    const sTag Tags::fontface              = Tag::create("fontface");
-    const sTag Tags::fontjustification     = Tag::create("fontjustification");
-    const sTag Tags::fontname              = Tag::create("fontname");
-    const sTag Tags::fontsize              = Tag::create("fontsize");
-    
-    const sTag Tags::gridsize              = Tag::create("gridsize");
-    const sTag Tags::hidden                = Tag::create("hidden");
-    
-    const sTag Tags::id                    = Tag::create("id");
-    const sTag Tags::ignoreclick           = Tag::create("ignoreclick");
-    const sTag Tags::italic                = Tag::create("italic");
-    
-    const sTag Tags::ledcolor              = Tag::create("ledcolor");
-    const sTag Tags::left                  = Tag::create("left");
-    const sTag Tags::link                  = Tag::create("link");
-    const sTag Tags::links                 = Tag::create("links");
-    const sTag Tags::locked_bgcolor        = Tag::create("locked_bgcolor");
-    
-    const sTag Tags::Menelo                = Tag::create("Menelo");
-    const sTag Tags::mescolor              = Tag::create("mescolor");
-    const sTag Tags::Message_Color         = Tag::create("Message Color");
-    
-    const sTag Tags::name                  = Tag::create("name");
-    const sTag Tags::newlink               = Tag::create("newlink");
-    const sTag Tags::newobject             = Tag::create("newobject");
-    const sTag Tags::ninlets               = Tag::create("ninlets");
-    const sTag Tags::normal                = Tag::create("normal");
-    const sTag Tags::noutlets              = Tag::create("noutlets");
-    
-    const sTag Tags::object                = Tag::create("object");
-    const sTag Tags::objects               = Tag::create("objects");
-    
-    const sTag Tags::patcher               = Tag::create("patcher");
-    const sTag Tags::position              = Tag::create("position");
-    const sTag Tags::presentation          = Tag::create("presentation");
-    const sTag Tags::presentation_position = Tag::create("presentation_position");
-    const sTag Tags::presentation_size     = Tag::create("presentation_size");
-    
-    const sTag Tags::removelink            = Tag::create("removelink");
-    const sTag Tags::removeobject          = Tag::create("removeobject");
-    const sTag Tags::right                 = Tag::create("right");
-    
-    const sTag Tags::set                   = Tag::create("set");
-    const sTag Tags::sigcolor              = Tag::create("sigcolor");
-    const sTag Tags::Signal_Color          = Tag::create("Signal Color");
-    const sTag Tags::size                  = Tag::create("size");
-    
-    const sTag Tags::text                  = Tag::create("text");
-    const sTag Tags::textcolor             = Tag::create("textcolor");
-    const sTag Tags::to                    = Tag::create("to");
-    
-    const sTag Tags::unlocked_bgcolor      = Tag::create("unlocked_bgcolor");
+    Tag::Shard Tag::m_shards[Tag::nshards];
+    vector<Tag::Entry> Tag::m_ids;
+    vector<uint32_t> Tag::m_free_ids;
+    mutex Tag::m_ids_mutex;
+    atomic_bool Tag::m_reclaim(false);
+    char* Tag::m_arena = nullptr;
+    char* Tag::m_arena_position = nullptr;
+    size_t Tag::m_arena_left = 0ul;
+    ulong Tag::m_arena_size = 0ul;
+    atomic_bool Tag::m_indexed(false);
+    mutex Tag::m_index_mutex;
+    shared_ptr<const Tag::Index> Tag::m_index;
+    vector<sTag> Tag::m_pending;
+    atomic<ulong> Tag::m_pending_size(0ul);
+    
+    // The ids of the built-in tags, in the order of their list.
+    enum BuiltinId : uint32_t
+    {
+#define KIWI_BUILTIN_ID(member, name) builtin_##member,
+        KIWI_BUILTIN_TAGS(KIWI_BUILTIN_ID)
+#undef KIWI_BUILTIN_ID
+        builtin_count
+    };
+    
+    // The tags of the names used by the library, they are constant objects so they are never allocated, locked or counted.
+    static constexpr Tag builtinTags[] =
+    {
+#define KIWI_BUILTIN_TAG(member, name) Tag(Tags::member, builtin_##member),
+        KIWI_BUILTIN_TAGS(KIWI_BUILTIN_TAG)
+#undef KIWI_BUILTIN_TAG
+    };
+    
+    static constexpr ulong nbuiltins = sizeof(builtinTags) / sizeof(Tag);
+    
+    // Retrieves if the built-in tags have the ids of their positions and unique names, the index of the built-in tags would only find the first tag of a name.
+    static constexpr bool checkBuiltinTags() noexcept
+    {
+        for(ulong i = 0; i < nbuiltins; i++)
+        {
+            if(builtinTags[i].getId() != i)
+            {
+                return false;
+            }
+            for(ulong j = i + 1ul; j < nbuiltins; j++)
+            {
+                if(builtinTags[i].getName() == builtinTags[j].getName())
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    
+    static_assert(nbuiltins == builtin_count && checkBuiltinTags(), "The built-in tags must have the ids of their positions and unique names");
+    
+    static constexpr ulong sumBuiltinBytes() noexcept
+    {
+        ulong bytes = 0ul;
+        for(ulong i = 0; i < nbuiltins; i++)
+        {
+            bytes += builtinTags[i].getName().size();
+        }
+        return bytes;
+    }
+    
+    static constexpr ulong builtinBytes = sumBuiltinBytes();
+    
+    // The open addressing table of the built-in tags, a slot holds the index of a tag plus one or zero if it is empty.
+    struct BuiltinIndex
+    {
+        static constexpr ulong size = 256ul;
+        uint16_t slots[size];
+    };
+    
+    static_assert(nbuiltins < BuiltinIndex::size / 2ul, "The table of the built-in tags is too small");
+    
+    static constexpr BuiltinIndex makeBuiltinIndex() noexcept
+    {
+        BuiltinIndex index{};
+        for(ulong i = 0; i < nbuiltins; i++)
+        {
+            ulong slot = builtinTags[i].getHash() & (BuiltinIndex::size - 1ul);
+            while(index.slots[slot])
+            {
+                slot = (slot + 1ul) & (BuiltinIndex::size - 1ul);
+            }
+            index.slots[slot] = uint16_t(i + 1ul);
+        }
+        return index;
+    }
+    
+    static constexpr BuiltinIndex builtinIndex = makeBuiltinIndex();
+    
+    // The deleter of the tags that are never deleted, the built-in tags and the tags of the arena.
+    struct TagKeeper
+    {
+        inline void operator()(const Tag*) const noexcept {}
+    };
+    
+    // The static storage of the control blocks of the built-in tags and of their shared pointers, so they are created without any allocation and never destroyed.
+    struct BuiltinStorage
+    {
+        static constexpr size_t block_size = 128ul;
+        alignas(max_align_t) char   blocks[nbuiltins * block_size];
+        size_t                      used;
+        alignas(sTag) char          tags[nbuiltins * sizeof(sTag)];
+    };
+    
+    static BuiltinStorage builtinStorage;
+    
+    // The allocator of the control blocks of the built-in tags, it reserves them in the static storage and never releases them.
+    template<class T> struct BuiltinAllocator
+    {
+        typedef T value_type;
+        
+        inline BuiltinAllocator() noexcept {}
+        
+        template<class U> inline BuiltinAllocator(BuiltinAllocator<U> const&) noexcept {}
+        
+        inline T* allocate(const size_t size)
+        {
+            static_assert(alignof(T) <= alignof(max_align_t), "The storage doesn't align the control blocks");
+            const size_t bytes = (size * sizeof(T) + alignof(max_align_t) - 1ul) & ~(alignof(max_align_t) - 1ul);
+            if(builtinStorage.used + bytes > sizeof(builtinStorage.blocks))
+            {
+                // the control blocks are larger than expected, they are never released anyway
+                return static_cast<T*>(::operator new(size * sizeof(T)));
+            }
+            T* block = reinterpret_cast<T*>(builtinStorage.blocks + builtinStorage.used);
+            builtinStorage.used += bytes;
+            return block;
+        }
+        
+        inline void deallocate(T*, const size_t) noexcept {}
+        
+        template<class U> inline bool operator==(BuiltinAllocator<U> const&) const noexcept {return true;}
+        
+        template<class U> inline bool operator!=(BuiltinAllocator<U> const&) const noexcept {return false;}
+    };
+    
+    // The shared pointers of the built-in tags, they are created once in the static storage with control blocks that are never released, so their weak pointers never expire.
+    static sTag const* getBuiltinTags() noexcept
+    {
+        static sTag const* const tags = []()
+        {
+            sTag* tags = reinterpret_cast<sTag*>(builtinStorage.tags);
+            for(ulong i = 0; i < nbuiltins; i++)
+            {
+                new(tags + i) sTag(&builtinTags[i], TagKeeper(), BuiltinAllocator<Tag>());
+            }
+            return tags;
+        }();
+        return tags;
+    }
+    
+    // Retrieves a built-in tag, the shared pointers are created by the first lookup so that they never allocate afterwards.
+    static inline sTag findBuiltin(string_view name, const uint64_t hash) noexcept
+    {
+        sTag const* tags = getBuiltinTags();
+        for(ulong slot = hash & (BuiltinIndex::size - 1ul); builtinIndex.slots[slot]; slot = (slot + 1ul) & (BuiltinIndex::size - 1ul))
+        {
+            const Tag& tag = builtinTags[builtinIndex.slots[slot] - 1u];
+            if(tag.getHash() == hash && tag.getName() == name)
+            {
+                return tags[builtinIndex.slots[slot] - 1u];
+            }
+        }
+        return sTag();
+    }
+    
+    // The tags that can be reclaimed, they own their names.
+    class Tag::Node : public Tag
+    {
+    private:
+        const string m_storage;
+    public:
+        inline Node(string_view name, const uint64_t hash, const uint32_t id) : Tag(string_view(), hash, id), m_storage(name)
+        {
+            m_name = m_storage;
+        }
+        
+        inline Node(string&& name, const uint64_t hash, const uint32_t id) : Tag(string_view(), hash, id), m_storage(move(name))
+        {
+            m_name = m_storage;
+        }
+    };
+    
+    // The tags retrieved recently by the thread, a slot is chosen by the hash of the name.
+    struct TagCacheEntry
+    {
+        uint64_t    hash;
+        sTag        tag;
+    };
+    
+    static const ulong tagCacheSize = 256ul;
+    static thread_local TagCacheEntry tagCache[tagCacheSize];
+    
+    // The statistics of the table, they are only updated with relaxed operations.
+    static atomic<ulong> statTags(0ul);
+    static atomic<ulong> statBytes(0ul);
+    static atomic<ulong> statHits(0ul);
+    static atomic<ulong> statCached(0ul);
+    static atomic<ulong> statMisses(0ul);
+    static atomic<ulong> statContentions(0ul);
+    static atomic<ulong> statWait(0ul);
+    
+    // The hits of the thread that haven't been added to the statistics yet, so the threads don't share a counter when they retrieve existing tags.
+    struct TagHits
+    {
+        ulong count = 0ul;
+        ulong cached = 0ul;
+        
+        inline ~TagHits() noexcept
+        {
+            statHits.fetch_add(count, memory_order_relaxed);
+            statCached.fetch_add(cached, memory_order_relaxed);
+        }
+    };
+    
+    static const ulong tagHitsBatch = 256ul;
+    static thread_local TagHits tagHits;
+    
+    static inline void countHit(const bool cached = false) noexcept
+    {
+        tagHits.cached += cached;
+        if(++tagHits.count == tagHitsBatch)
+        {
+            statHits.fetch_add(tagHitsBatch, memory_order_relaxed);
+            statCached.fetch_add(tagHits.cached, memory_order_relaxed);
+            tagHits.count = 0ul;
+            tagHits.cached = 0ul;
+        }
+    }
+    
+    // Locks a mutex of the table, the time spent waiting is only measured when the mutex is already locked.
+    static inline void acquire(mutex& m) noexcept
+    {
+        if(!m.try_lock())
+        {
+            const auto start = chrono::steady_clock::now();
+            m.lock();
+            statContentions.fetch_add(1ul, memory_order_relaxed);
+            statWait.fetch_add(ulong(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()), memory_order_relaxed);
+        }
+    }
+    
+    template<class T> struct Tag::Allocator
+    {
+        typedef T value_type;
+        
+        inline Allocator() noexcept {}
+        
+        template<class U> inline Allocator(Allocator<U> const&) noexcept {}
+        
+        inline T* allocate(const size_t size) noexcept
+        {
+            static_assert(alignof(T) <= alignof(Tag), "The arena doesn't align the control blocks");
+            return static_cast<T*>(Tag::allocate(size * sizeof(T)));
+        }
+        
+        inline void deallocate(T*, const size_t) noexcept {}
+        
+        template<class U> inline bool operator==(Allocator<U> const&) const noexcept {return true;}
+        
+        template<class U> inline bool operator!=(Allocator<U> const&) const noexcept {return false;}
+    };
+    
+    void* Tag::allocate(const size_t bytes) noexcept
+    {
+        static_assert(sizeof(char*) % alignof(Tag) == 0, "The link of the blocks of the arena breaks their alignment");
+        const size_t size = (bytes + alignof(Tag) - 1ul) & ~(alignof(Tag) - 1ul);
+        // the blocks are linked and never released, so the tags and their control blocks outlive the shared pointers destroyed at the exit
+        auto link = [](const size_t capacity)
+        {
+            char* block = new char[sizeof(char*) + capacity];
+            memcpy(block, &m_arena, sizeof(char*));
+            m_arena = block;
+            m_arena_size += sizeof(char*) + capacity;
+            return block + sizeof(char*);
+        };
+        char* position;
+        if(size > arena_block_size / 4ul)
+        {
+            // the long names have their own blocks so they don't waste the end of the current block
+            position = link(size);
+        }
+        else
+        {
+            if(size > m_arena_left)
+            {
+                m_arena_position = link(arena_block_size);
+                m_arena_left     = arena_block_size;
+            }
+            position = m_arena_position;
+            m_arena_position += size;
+            m_arena_left     -= size;
+        }
+        return position;
+    }
+    
+    sTag Tag::store(string_view name, const uint64_t hash, const uint32_t id) noexcept
+    {
+        char* position = static_cast<char*>(allocate(sizeof(Tag) + name.size()));
+        char* data = position + sizeof(Tag);
+        if(!name.empty())
+        {
+            memcpy(data, name.data(), name.size());
+        }
+        return sTag(new(position) Tag(string_view(data, name.size()), hash, id), TagKeeper(), Allocator<Tag>());
+    }
+    
+    template<class Name> sTag Tag::intern(Name&& name, const uint64_t hash) noexcept
+    {
+        {
+            // the built-in tags aren't counted in the statistics
+            sTag tag = findBuiltin(string_view(name), hash);
+            if(tag)
+            {
+                return tag;
+            }
+        }
+        Shard& shard = getShard(hash);
+        acquire(shard.m_mutex);
+        lock_guard<mutex> guard(shard.m_mutex, adopt_lock);
+        auto it = shard.m_tags.find(string_view(name));
+        if(it != shard.m_tags.end())
+        {
+            if(it->second.strong)
+            {
+                countHit();
+                return it->second.strong;
+            }
+            sTag tag = it->second.weak.lock();
+            if(tag)
+            {
+                countHit();
+                return tag;
+            }
+            // the tag is being deleted, its deleter won't find this entry anymore
+            shard.m_tags.erase(it);
+        }
+        
+        const bool reclaim = m_reclaim;
+        acquire(m_ids_mutex);
+        lock_guard<mutex> ids_guard(m_ids_mutex, adopt_lock);
+        uint32_t id = uint32_t(nbuiltins + m_ids.size());
+        if(!m_free_ids.empty())
+        {
+            id = m_free_ids.back();
+            m_free_ids.pop_back();
+        }
+        // the tags owned by the table are never deleted, so they are stored in the arena with their control blocks
+        sTag tag = reclaim ? sTag(new Node(forward<Name>(name), hash, id), Deleter()) : store(string_view(name), hash, id);
+        const Entry entry{tag.get(), tag, reclaim ? sTag() : tag};
+        if(id - nbuiltins == m_ids.size())
+        {
+            m_ids.push_back(entry);
+        }
+        else
+        {
+            m_ids[id - nbuiltins] = entry;
+        }
+        shard.m_tags.emplace(tag->m_name, entry);
+        if(!reclaim && m_indexed)
+        {
+            m_pending.push_back(tag);
+            m_pending_size.store(m_pending.size(), memory_order_release);
+        }
+        statTags.fetch_add(1ul, memory_order_relaxed);
+        statBytes.fetch_add(tag->m_name.size(), memory_order_relaxed);
+        statMisses.fetch_add(1ul, memory_order_relaxed);
+        return tag;
+    }
+    
+    void Tag::Deleter::operator()(const Tag* tag) const noexcept
+    {
+        {
+            Shard& shard = getShard(tag->m_hash);
+            acquire(shard.m_mutex);
+            lock_guard<mutex> guard(shard.m_mutex, adopt_lock);
+            auto it = shard.m_tags.find(tag->m_name);
+            if(it != shard.m_tags.end() && it->second.tag == tag)
+            {
+                shard.m_tags.erase(it);
+            }
+        }
+        {
+            acquire(m_ids_mutex);
+            lock_guard<mutex> guard(m_ids_mutex, adopt_lock);
+            m_ids[tag->m_id - nbuiltins] = Entry{nullptr, wTag(), sTag()};
+            m_free_ids.push_back(tag->m_id);
+        }
+        statTags.fetch_sub(1ul, memory_order_relaxed);
+        statBytes.fetch_sub(tag->m_name.size(), memory_order_relaxed);
+        delete static_cast<const Node*>(tag);
+    }
+    
+    Tag::Census Tag::getCensus() noexcept
+    {
+        Census census{nbuiltins, 0ul, 0ul, 0ul};
+        for(ulong i = 0; i < nshards; i++)
+        {
+            lock_guard<mutex> guard(m_shards[i].m_mutex);
+            for(auto const& it : m_shards[i].m_tags)
+            {
+                if(it.second.strong)
+                {
+                    census.strong++;
+                }
+                else if(it.second.weak.expired())
+                {
+                    census.expired++;
+                }
+                else
+                {
+                    census.weak++;
+                }
+            }
+        }
+        lock_guard<mutex> guard(m_ids_mutex);
+        census.arena = m_arena_size;
+        return census;
+    }
+    
+    Tag::Stats Tag::getStats() noexcept
+    {
+        Stats stats;
+        stats.tags          = nbuiltins + statTags.load(memory_order_relaxed);
+        stats.bytes         = builtinBytes + statBytes.load(memory_order_relaxed);
+        stats.hits          = statHits.load(memory_order_relaxed) + tagHits.count;
+        stats.cached        = statCached.load(memory_order_relaxed) + tagHits.cached;
+        stats.misses        = statMisses.load(memory_order_relaxed);
+        stats.contentions   = statContentions.load(memory_order_relaxed);
+        stats.wait          = statWait.load(memory_order_relaxed);
+        {
+            lock_guard<mutex> guard(m_ids_mutex);
+            stats.arena = m_arena_size;
+        }
+        return stats;
+    }
+    
+    Atom Tag::Stats::toAtom() const
+    {
+        Dico dico;
+        dico[Tag::create("tags"_tag)]         = Atom(long(tags));
+        dico[Tag::create("bytes"_tag)]        = Atom(long(bytes));
+        dico[Tag::create("arena"_tag)]        = Atom(long(arena));
+        dico[Tag::create("hits"_tag)]         = Atom(long(hits));
+        dico[Tag::create("cached"_tag)]       = Atom(long(cached));
+        dico[Tag::create("misses"_tag)]       = Atom(long(misses));
+        dico[Tag::create("contentions"_tag)]  = Atom(long(contentions));
+        dico[Tag::create("wait"_tag)]         = Atom(long(wait));
+        return Atom(move(dico));
+    }
+    
+    static inline bool nameLess(sTag const& lhs, sTag const& rhs) noexcept
+    {
+        return lhs->getName() < rhs->getName();
+    }
+    
+    void Tag::setIndexed(const bool indexed) noexcept
+    {
+        lock_guard<mutex> index_guard(m_index_mutex);
+        lock_guard<mutex> ids_guard(m_ids_mutex);
+        if(indexed && !m_indexed)
+        {
+            // the first snapshot is built by the next query from all the tags owned by the table
+            m_pending.clear();
+            m_pending.reserve(nbuiltins + m_ids.size());
+            for(ulong i = 0; i < nbuiltins; i++)
+            {
+                m_pending.push_back(getBuiltinTags()[i]);
+            }
+            for(auto const& entry : m_ids)
+            {
+                if(entry.strong)
+                {
+                    m_pending.push_back(entry.strong);
+                }
+            }
+            atomic_store(&m_index, shared_ptr<const Index>(make_shared<Index>(Index{make_shared<const vector<sTag>>(), make_shared<const vector<sTag>>(), vector<sTag>()})));
+        }
+        else if(!indexed && m_indexed)
+        {
+            vector<sTag>().swap(m_pending);
+            atomic_store(&m_index, shared_ptr<const Index>());
+        }
+        m_pending_size.store(m_pending.size(), memory_order_release);
+        m_indexed = indexed;
+    }
+    
+    // The maximum size of the recent tags of the index, they are copied by each query that follows a creation.
+    static const ulong indexRecentSize = 32ul;
+    
+    // The minimum size of the overlay of the index before it is merged into the sorted tags.
+    static const ulong indexOverlaySize = 1024ul;
+    
+    vector<sTag> Tag::getTagsWithPrefix(string_view prefix, const ulong count)
+    {
+        if(m_pending_size.load(memory_order_acquire))
+        {
+            lock_guard<mutex> index_guard(m_index_mutex);
+            vector<sTag> pending;
+            {
+                lock_guard<mutex> ids_guard(m_ids_mutex);
+                pending.swap(m_pending);
+                m_pending_size.store(0ul, memory_order_relaxed);
+            }
+            const shared_ptr<const Index> current = atomic_load(&m_index);
+            if(current && !pending.empty())
+            {
+                sort(pending.begin(), pending.end(), nameLess);
+                auto index = make_shared<Index>();
+                index->sorted = current->sorted;
+                index->overlay = current->overlay;
+                vector<sTag> recent;
+                recent.reserve(current->recent.size() + pending.size());
+                merge(current->recent.begin(), current->recent.end(), make_move_iterator(pending.begin()), make_move_iterator(pending.end()), back_inserter(recent), nameLess);
+                if(recent.size() <= indexRecentSize)
+                {
+                    index->recent = move(recent);
+                }
+                else
+                {
+                    auto overlay = make_shared<vector<sTag>>();
+                    overlay->reserve(current->overlay->size() + recent.size());
+                    merge(current->overlay->begin(), current->overlay->end(), make_move_iterator(recent.begin()), make_move_iterator(recent.end()), back_inserter(*overlay), nameLess);
+                    // the overlay is merged once its copies cost as much as a merge of the sorted tags, which compares the names of all the tags
+                    const ulong size = ulong(overlay->size());
+                    if(size <= indexOverlaySize || size * size <= current->sorted->size() * 256ul)
+                    {
+                        index->overlay = move(overlay);
+                    }
+                    else
+                    {
+                        auto sorted = make_shared<vector<sTag>>();
+                        sorted->reserve(current->sorted->size() + size);
+                        merge(current->sorted->begin(), current->sorted->end(), make_move_iterator(overlay->begin()), make_move_iterator(overlay->end()), back_inserter(*sorted), nameLess);
+                        index->sorted = move(sorted);
+                        index->overlay = make_shared<const vector<sTag>>();
+                    }
+                }
+                atomic_store(&m_index, shared_ptr<const Index>(move(index)));
+            }
+        }
+        
+        vector<sTag> tags;
+        const shared_ptr<const Index> index = atomic_load(&m_index);
+        if(index)
+        {
+            auto less = [](sTag const& tag, string_view name)
+            {
+                return tag->getName() < name;
+            };
+            auto matches = [prefix](sTag const& tag)
+            {
+                return tag->getName().substr(0, prefix.size()) == prefix;
+            };
+            // the three sorted parts of the snapshot are searched together, their tags are different
+            typedef vector<sTag>::const_iterator Iterator;
+            array<pair<Iterator, Iterator>, 3> ranges;
+            ulong position = 0ul;
+            for(vector<sTag> const* part : {index->sorted.get(), index->overlay.get(), &index->recent})
+            {
+                ranges[position++] = make_pair(lower_bound(part->begin(), part->end(), prefix, less), part->end());
+            }
+            // the snapshot holds the shared pointers of the tags, so the results are copied without locking the table
+            while(tags.size() < count)
+            {
+                pair<Iterator, Iterator>* first = nullptr;
+                for(auto& range : ranges)
+                {
+                    if(range.first != range.second && matches(*range.first) && (!first || nameLess(*range.first, *first->first)))
+                    {
+                        first = &range;
+                    }
+                }
+                if(!first)
+                {
+                    break;
+                }
+                tags.push_back(*first->first++);
+            }
+        }
+        return tags;
+    }
+    
+    sTag Tag::fromId(const uint32_t id) noexcept
+    {
+        if(id < nbuiltins)
+        {
+            return getBuiltinTags()[id];
+        }
+        sTag tag;
+        {
+            lock_guard<mutex> guard(m_ids_mutex);
+            if(id - nbuiltins < m_ids.size())
+            {
+                Entry const& entry = m_ids[id - nbuiltins];
+                tag = entry.strong ? entry.strong : entry.weak.lock();
+            }
+        }
+        return tag;
+    }
+    
+    ulong Tag::getNumberOfIds() noexcept
+    {
+        lock_guard<mutex> guard(m_ids_mutex);
+        return nbuiltins + ulong(m_ids.size());
+    }
+    
+    // The first bytes of a snapshot of the tags.
+    static const char snapshotMagic[4] = {'K', 'T', 'A', 'G'};
+    
+    // The number of ids that a snapshot can skip beyond its number of tags, the ids skipped are the ones freed by the reclaimed tags.
+    static constexpr ulong snapshotSlack = 1ul << 16;
+    
+    ulong Tag::save(string const& path)
+    {
+        vector<sTag> tags;
+        {
+            lock_guard<mutex> guard(m_ids_mutex);
+            tags.reserve(m_ids.size());
+            for(auto const& entry : m_ids)
+            {
+                sTag tag = entry.strong ? entry.strong : entry.weak.lock();
+                if(tag)
+                {
+                    tags.push_back(move(tag));
+                }
+            }
+        }
+        
+        string output(snapshotMagic, sizeof(snapshotMagic));
+        writeVarint(tags.size(), output);
+        for(auto const& tag : tags)
+        {
+            writeVarint(tag->m_id, output);
+            writeVarint(tag->m_name.size(), output);
+            output += tag->m_name;
+        }
+        
+        ofstream file(path, ios::out | ios::binary | ios::trunc);
+        if(!file.is_open())
+        {
+            throw Error("Can't open the file " + path);
+        }
+        file.write(output.data(), streamsize(output.size()));
+        if(!file)
+        {
+            throw Error("Can't write the file " + path);
+        }
+        return ulong(tags.size());
+    }
+    
+    ulong Tag::load(string const& path)
+    {
+        const string text = readFile(path);
+        
+        // The snapshot is decoded and checked before taking any lock.
+        struct Record
+        {
+            uint32_t    id;
+            uint64_t    hash;
+            string_view name;
+        };
+        vector<Record> records;
+        ulong counts[nshards] = {};
+        {
+            const char* data = text.data();
+            const char* end  = data + text.size();
+            uint64_t count;
+            if(text.size() < sizeof(snapshotMagic) || memcmp(data, snapshotMagic, sizeof(snapshotMagic)) || !readVarint(data += sizeof(snapshotMagic), end, count) || count > text.size())
+            {
+                throw Error("The file " + path + " isn't a snapshot of the tags");
+            }
+            records.reserve(size_t(count));
+            unordered_set<string_view> names;
+            names.reserve(size_t(count));
+            for(uint64_t i = 0; i < count; i++)
+            {
+                uint64_t id, length;
+                // The ids are bounded by the number of tags, so a corrupted file can't make the table of the ids grow beyond its size.
+                if(!readVarint(data, end, id) || !readVarint(data, end, length) || length > uint64_t(end - data) || id < nbuiltins || id >= nbuiltins + count + snapshotSlack || (!records.empty() && id <= records.back().id))
+                {
+                    throw Error("The snapshot of the tags " + path + " is corrupted");
+                }
+                const string_view name(data, size_t(length));
+                if(!names.insert(name).second)
+                {
+                    throw Error("The snapshot of the tags " + path + " contains the tag " + string(name) + " twice");
+                }
+                const uint64_t hash = hashBytes(name.data(), name.size());
+                records.push_back(Record{uint32_t(id), hash, name});
+                counts[&getShard(hash) - m_shards]++;
+                data += length;
+            }
+            if(data != end)
+            {
+                throw Error("The snapshot of the tags " + path + " is corrupted");
+            }
+        }
+        
+        // The tags that already exist, they are released after the locks because the last reference of a tag that can be reclaimed takes the lock of its shard.
+        vector<sTag> existing(records.size());
+        
+        // Each shard is locked once, always before the ids like in the creation of a tag.
+        vector<unique_lock<mutex>> locks;
+        locks.reserve(nshards);
+        for(ulong i = 0; i < nshards; i++)
+        {
+            locks.emplace_back(m_shards[i].m_mutex);
+        }
+        lock_guard<mutex> ids_guard(m_ids_mutex);
+        
+        for(size_t i = 0; i < records.size(); i++)
+        {
+            Record const& record = records[i];
+            if(findBuiltin(record.name, record.hash))
+            {
+                throw Error("The snapshot of the tags " + path + " conflicts with the built-in tag " + string(record.name));
+            }
+            Shard& shard = getShard(record.hash);
+            auto it = shard.m_tags.find(record.name);
+            if(it != shard.m_tags.end())
+            {
+                existing[i] = it->second.strong ? it->second.strong : it->second.weak.lock();
+                if(!existing[i] || existing[i]->m_id != record.id)
+                {
+                    throw Error("The snapshot of the tags " + path + " conflicts with the tag " + string(record.name));
+                }
+            }
+            else if(record.id - nbuiltins < m_ids.size() && m_ids[record.id - nbuiltins].tag)
+            {
+                throw Error("The snapshot of the tags " + path + " conflicts with the id " + to_string(record.id));
+            }
+        }
+        
+        if(!records.empty() && records.back().id - nbuiltins >= m_ids.size())
+        {
+            m_ids.resize(records.back().id - nbuiltins + 1ul, Entry{nullptr, wTag(), sTag()});
+        }
+        for(ulong i = 0; i < nshards; i++)
+        {
+            m_shards[i].m_tags.reserve(m_shards[i].m_tags.size() + counts[i]);
+        }
+        ulong created = 0ul;
+        for(size_t i = 0; i < records.size(); i++)
+        {
+            Record const& record = records[i];
+            if(existing[i])
+            {
+                // A tag that can be reclaimed becomes owned by the table, otherwise its id could be given to another name.
+                // A reference is also kept out of the table and never released, so the deleter of the tag never runs, even when the table is destroyed.
+                Entry& entry = getShard(record.hash).m_tags.find(record.name)->second;
+                if(!entry.strong)
+                {
+                    static vector<sTag>& promoted = *new vector<sTag>();
+                    promoted.push_back(existing[i]);
+                    entry.strong = existing[i];
+                    m_ids[record.id - nbuiltins].strong = existing[i];
+                    if(m_indexed)
+                    {
+                        m_pending.push_back(existing[i]);
+                    }
+                }
+            }
+            else
+            {
+                const sTag tag = store(record.name, record.hash, record.id);
+                const Entry entry{tag.get(), tag, tag};
+                m_ids[record.id - nbuiltins] = entry;
+                getShard(record.hash).m_tags.emplace(tag->m_name, entry);
+                statBytes.fetch_add(record.name.size(), memory_order_relaxed);
+                if(m_indexed)
+                {
+                    m_pending.push_back(tag);
+                }
+                created++;
+            }
+        }
+        m_pending_size.store(m_pending.size(), memory_order_release);
+        
+        // The ids that are still free, including the ones skipped by the snapshot, are given to the next tags.
+        m_free_ids.clear();
+        for(size_t i = m_ids.size(); i > 0; i--)
+        {
+            if(!m_ids[i - 1].tag)
+            {
+                m_free_ids.push_back(uint32_t(nbuiltins + i - 1));
+            }
+        }
+        statTags.fetch_add(created, memory_order_relaxed);
+        return created;
+    }
+    
+    template<class Name> sTag const& Tag::lookup(Name&& name, const uint64_t hash) noexcept
+    {
+        TagCacheEntry& entry = tagCache[hash & (tagCacheSize - 1ul)];
+        if(entry.hash != hash || !entry.tag || entry.tag->m_name != string_view(name))
+        {
+            entry.tag   = intern(forward<Name>(name), hash);
+            entry.hash  = hash;
+        }
+        else if(entry.tag->m_id >= nbuiltins)
+        {
+            countHit(true);
+        }
+        return entry.tag;
+    }
+    
+    sTag Tag::create(string_view name) noexcept
+    {
+        return lookup(name, hashBytes(name.data(), name.size()));
+    }
+    
+    sTag Tag::create(string&& name) noexcept
+    {
+        const uint64_t hash = hashBytes(name.data(), name.size());
+        return lookup(move(name), hash);
+    }
+    
+    Tag const& Tag::get(string_view name) noexcept
+    {
+        return *lookup(name, hashBytes(name.data(), name.size()));
+    }
+    
+    sTag Tag::create(Literal const& literal) noexcept
+    {
+        // the built-in tags are retrieved from their constant table without going through the cache of the thread
+        sTag tag = findBuiltin(literal.getName(), literal.getHash());
+        return tag ? tag : lookup(literal.getName(), literal.getHash());
+    }
 }
 
 
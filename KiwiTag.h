@@ -39,166 +39,462 @@ namespace Kiwi
      */
     class Tag
     {
-    private:
-        const string m_name;
     public:
-        
-        //! The constructor.
-        /** You should never use this method except if you really know what you do.
+    
+        //! A tag name known at compile time.
+        /** The literal holds a name and its hash computed at compile time, it is created with the _tag suffix. It can be compared to a tag without creating it and converted to the tag.
+         @see operator""_tag
          */
-        inline Tag(string const& name) noexcept : m_name(name) {}
+        class Literal
+        {
+        private:
+            const string_view   m_name;
+            const uint64_t      m_hash;
+        public:
         
+            //! The constructor.
+            /** The function computes the hash of the name.
+             @param name The name.
+             @param size The size of the name.
+             */
+            constexpr inline Literal(const char* name, const size_t size) noexcept : m_name(name, size), m_hash(hashBytes(name, size)) {}
+            
+            //! Retrieve the name of the literal.
+            constexpr inline string_view getName() const noexcept {return m_name;}
+            
+            //! Retrieve the hash of the name of the literal.
+            constexpr inline uint64_t getHash() const noexcept {return m_hash;}
+            
+            //! Retrieve the tag of the literal.
+            inline operator sTag() const noexcept;
+            
+            //! Access the tag of the literal.
+            /** The operator retrieves the tag of the literal, so the members of Tags can still be used like tags, for example Tags::name->getName().
+             @return The tag.
+             */
+            inline sTag operator->() const noexcept;
+        };
+    
+    private:
+        friend TagLess;
+        friend TagHash;
+        class Node;
+        string_view     m_name;
+        const uint64_t  m_hash;
+        const uint32_t  m_id;
+    public:
+    
         //! The constructor.
-        /** You should never use this method except if you really know what you do.
+        /** You should never use this method except if you really know what you do. The tag doesn't own its name.
          */
-        inline Tag(string&& name) noexcept : m_name(name) {}
+        constexpr inline Tag(string_view name, const uint64_t hash, const uint32_t id) noexcept : m_name(name), m_hash(hash), m_id(id) {}
         
-        //! The destructor.
-        /** You should never use this method except if you really know what you do.
+        //! The constructor.
+        /** You should never use this method except if you really know what you do. The tag doesn't own its name, it is used for the tags built in the library.
          */
-        inline ~Tag() noexcept {}
+        constexpr inline Tag(Literal const& literal, const uint32_t id) noexcept : m_name(literal.getName()), m_hash(literal.getHash()), m_id(id) {}
         
         //! Retrieve the string of the tag.
         /** The function retrieves the unique string of the tag.
          @return The string of the tag.
          */
-        inline string getName() const noexcept { return m_name; }
+        constexpr inline string_view getName() const noexcept { return m_name; }
+        
+        //! Retrieve the hash of the tag.
+        /** The function retrieves the hash of the name of the tag computed at its creation, it is the hashBytes function of the name so it is the same from one run to another.
+         @return The hash of the tag.
+         */
+        constexpr inline uint64_t getHash() const noexcept { return m_hash; }
+        
+        //! Retrieve the id of the tag.
+        /** The function retrieves the id of the tag. The built-in tags have the first ids and the other ids are given in the order of creation, so they can index arrays. The ids are only valid during a run.
+         @return The id of the tag.
+         */
+        constexpr inline uint32_t getId() const noexcept { return m_id; }
+        
+        //! Retrieve a tag with its id.
+        /** The function retrieves the tag that has an id.
+         @param id  The id of the tag.
+         @return The tag or nullptr if no tag has this id.
+         */
+        static sTag fromId(const uint32_t id) noexcept;
+        
+        //! Retrieve the number of ids.
+        /** The function retrieves the number of ids given, all the ids are lower than this number.
+         @return The number of ids.
+         */
+        static ulong getNumberOfIds() noexcept;
+        
+        //! Sets if the tags can be reclaimed.
+        /** The function sets if the tags created from now on are reclaimed when they are no longer used. By default the table owns the tags, so they live until the end of the program and they are stored with their names in large blocks of memory, and a program that creates tags from user texts, file paths or generated names can grow the table without bound. When the tags are reclaimed, the table only keeps weak references and a tag removes its entry and gives its id back when its last reference is released, so the table follows the tags in use without any sweep. The tags created before keep their mode. Note that each thread keeps the tags it retrieved recently in a small cache, so a few unused tags stay alive until they leave the cache.
+         @param reclaim True to reclaim the new tags, false to keep them forever.
+         */
+        static inline void setReclaim(const bool reclaim) noexcept {m_reclaim = reclaim;}
+        
+        //! Retrieves if the tags can be reclaimed.
+        /** The function retrieves if the tags created from now on are reclaimed when they are no longer used.
+         @return True if the tags are reclaimed, otherwise false.
+         */
+        static inline bool getReclaim() noexcept {return m_reclaim;}
+        
+        //! The census of the table.
+        struct Census
+        {
+            ulong strong;   //!< The number of tags owned by the table.
+            ulong weak;     //!< The number of tags that can be reclaimed and are still used.
+            ulong expired;  //!< The number of tags that are no longer used and are being removed.
+            ulong arena;    //!< The number of bytes reserved to store the tags owned by the table, their control blocks and their names.
+        };
+        
+        //! Counts the entries of the table.
+        /** The function walks through the table, locking one shard at a time, and counts the entries by their state.
+         @return The census of the table.
+         */
+        static Census getCensus() noexcept;
+        
+        //! The statistics of the table.
+        struct Stats
+        {
+            ulong tags;         //!< The number of tags alive, including the built-in tags.
+            ulong bytes;        //!< The number of bytes of the names of the tags alive.
+            ulong arena;        //!< The number of bytes reserved to store the tags owned by the table, their control blocks and their names.
+            ulong hits;         //!< The number of retrievals of existing tags, the retrievals of the built-in tags aren't counted.
+            ulong cached;       //!< The number of retrievals served by the caches of the threads, they are included in the hits.
+            ulong misses;       //!< The number of tags created.
+            ulong contentions;  //!< The number of times a lock of the table was already locked.
+            ulong wait;         //!< The time spent waiting for the locks of the table in nanoseconds.
+            
+            //! Retrieves the statistics as a dico.
+            /** The function retrieves the statistics as a dico whose keys are the names of the members, so they can be written in json.
+             @return The dico of the statistics.
+             */
+            Atom toAtom() const;
+        };
+        
+        //! Retrieves the statistics of the table.
+        /** The function retrieves the statistics of the table without locking it, except to read the size of the arena. The counters are only updated with relaxed atomic operations, and the time is only measured when a lock is already locked, so they don't slow down the table. Each thread adds its hits to the counter by batches, so the hits of the other threads can be behind by a few hundreds.
+         @return The statistics.
+         */
+        static Stats getStats() noexcept;
+        
+        //! Sets if the tags are indexed by prefix.
+        /** The function enables or disables the index of the names of the tags owned by the table, it is disabled by default. The index is a sorted snapshot of the tags that is shared by the readers, the tags created after the snapshot are added to a pending list while holding the lock the creation already takes, so the index never blocks the creation of the tags. The next query sorts the pending tags into a few recent tags, then into an overlay once they are more than 32, both searched with the snapshot, and the overlay is only merged into a new snapshot once it holds more than about the square root of the number of tags, so creating a tag between two queries doesn't copy the whole index. The tags that can be reclaimed aren't indexed.
+         @param indexed True to index the tags, false to release the index.
+         */
+        static void setIndexed(const bool indexed) noexcept;
+        
+        //! Retrieves if the tags are indexed by prefix.
+        /** The function retrieves if the names of the tags owned by the table are indexed.
+         @return True if the tags are indexed, otherwise false.
+         */
+        static inline bool getIndexed() noexcept {return m_indexed;}
+        
+        //! Retrieves the tags that start with a prefix.
+        /** The function searches the index for the first tags in the order of the names that start with a prefix, it can be used to complete a name. The search only takes the lock of the index when tags have been created since the last query, and it never takes the lock of the table while it copies the tags.
+         @param prefix  The prefix of the names.
+         @param count   The maximum number of tags to retrieve.
+         @return The tags in the order of their names or an empty vector if the tags aren't indexed.
+         */
+        static vector<sTag> getTagsWithPrefix(string_view prefix, const ulong count);
+        
+        //! Saves a snapshot of the tags.
+        /** The function writes the names and the ids of the tags in use to a compact file, the built-in tags aren't saved. The snapshot can be loaded at the start of another run, so the tags get their ids back and the binary files can refer to the tags by their ids.
+         @param path The path of the file.
+         @return The number of tags saved.
+         */
+        static ulong save(string const& path);
+        
+        //! Loads a snapshot of the tags.
+        /** The function creates the tags of a snapshot with their ids in one pass. The snapshot is decoded before taking any lock, then each shard is locked once, the tables are sized for the new tags and the tags are stored in the table without locking them one by one. The tags of a snapshot are owned by the table. The function should be called at startup, before the tags of the snapshot are created, nevertheless a tag that already exists with the same id is kept and becomes owned by the table if it could be reclaimed. If the file can't be read, isn't a snapshot, if its ids are too sparse for its number of tags, if it holds a name twice, or if a name or an id of the snapshot is already used by another tag, the function throws an Error and no tag is created.
+         @param path The path of the file.
+         @return The number of tags created.
+         */
+        static ulong load(string const& path);
     
     private:
+    
+        //! An entry of the table, it owns the tag only if the tag can't be reclaimed.
+        struct Entry
+        {
+            const Tag*  tag;
+            wTag        weak;
+            sTag        strong;
+        };
         
-        static map<string, sTag> m_tags;
-        static mutex             m_mutex;
-
+        //! A part of the table of the tags with its own lock.
+        struct alignas(64) Shard
+        {
+            mutex                               m_mutex;
+            unordered_map<string_view, Entry>   m_tags;
+        };
+        
+        //! The deleter of the tags that can be reclaimed, it removes the tag from the table.
+        struct Deleter
+        {
+            void operator()(const Tag* tag) const noexcept;
+        };
+        
+        //! A snapshot of the index, the sorted tags and the overlay of the tags indexed since they were sorted are shared by the snapshots, and the recent tags are the few tags indexed since the overlay was built. The three parts are sorted and hold the shared pointers of the tags, so the queries copy them without locking the table.
+        struct Index
+        {
+            shared_ptr<const vector<sTag>>  sorted;
+            shared_ptr<const vector<sTag>>  overlay;
+            vector<sTag>                    recent;
+        };
+        
+        //! The allocator of the control blocks of the tags owned by the table, it reserves them in the arena and never releases them.
+        template<class T> struct Allocator;
+        
+        static const ulong      nshards = 64ul;
+        static Shard            m_shards[nshards];
+        static vector<Entry>    m_ids;
+        static vector<uint32_t> m_free_ids;
+        static mutex            m_ids_mutex;
+        static atomic_bool      m_reclaim;
+        
+        static const size_t                         arena_block_size = 65536ul;
+        static char*                                m_arena;
+        static char*                                m_arena_position;
+        static size_t                               m_arena_left;
+        static ulong                                m_arena_size;
+        
+        static atomic_bool                          m_indexed;
+        static mutex                                m_index_mutex;
+        static shared_ptr<const Index>              m_index;
+        static vector<sTag>                         m_pending;
+        static atomic<ulong>                        m_pending_size;
+        
+        //! Retrieves the shard of a hash.
+        static inline Shard& getShard(const uint64_t hash) noexcept
+        {
+            return m_shards[(hash >> 32) & (nshards - 1ul)];
+        }
+        
+        //! Reserves memory in the arena, the ids lock must be held.
+        static void* allocate(const size_t size) noexcept;
+        
+        //! Stores a tag, its name and its control block in the arena, the ids lock must be held.
+        static sTag store(string_view name, const uint64_t hash, const uint32_t id) noexcept;
+        
+        //! Retrieves or creates a tag in its shard.
+        template<class Name> static sTag intern(Name&& name, const uint64_t hash) noexcept;
+        
+        //! Retrieves or creates a tag through the cache of the thread, the reference is the one of the cache.
+        template<class Name> static sTag const& lookup(Name&& name, const uint64_t hash) noexcept;
+    
     public:
+    
+        //! Tag creator.
+        /** This function checks if a tag with this name has already been created and returns it, otherwise it creates a new tag with this name. The tags are spread over several shards by the hash of their names and each shard has its own lock, so the threads that create different tags rarely wait for each other. The tables are indexed by views of the names owned by the tags, so retrieving an existing tag never allocates memory. Each thread also keeps the tags it retrieved recently in a small cache, so the repeated lookups of the same names don't take any lock.
+         @param  name   The name of the tag to retrieve.
+         @return    The tag that match with the name.
+         */
+        static sTag create(string_view name) noexcept;
         
         //! Tag creator.
         /** This function checks if a tag with this name has already been created and returns it, otherwise it creates a new tag with this name.
          @param  name   The name of the tag to retrieve.
+         @param  size   The size of the name.
          @return    The tag that match with the name.
          */
-        static inline sTag create(string const& name) noexcept
-        {
-            lock_guard<mutex> guard(m_mutex);
-            auto it = m_tags.find(name);
-            if(it != m_tags.end())
-            {
-                return it->second;
-            }
-            else
-            {
-                sTag tag = make_shared<Tag>(name);
-                m_tags[name] = tag;
-                return tag;
-            }
-        }
+        static inline sTag create(const char* name, const size_t size) noexcept {return create(string_view(name, size));}
+        
+        //! Tag creator.
+        /** This function checks if a tag with this name has already been created and returns it, otherwise it creates a new tag with this name.
+         @param  name   The null-terminated name of the tag to retrieve.
+         @return    The tag that match with the name.
+         */
+        static inline sTag create(const char* name) noexcept {return create(string_view(name));}
         
         //! Tag creator.
         /** This function checks if a tag with this name has already been created and returns it, otherwise it creates a new tag with this name.
          @param  name   The name of the tag to retrieve.
          @return    The tag that match with the name.
          */
-        static inline sTag create(string&& name) noexcept
-        {
-            lock_guard<mutex> guard(m_mutex);
-            auto it = m_tags.find(name);
-            if(it != m_tags.end())
-            {
-                return it->second;
-            }
-            else
-            {
-                sTag tag = make_shared<Tag>(name);
-                m_tags[name] = tag;
-                return tag;
-            }
-        }
+        static inline sTag create(string const& name) noexcept {return create(string_view(name));}
+        
+        //! Tag creator.
+        /** This function checks if a tag with this name has already been created and returns it, otherwise it creates a new tag that takes the name.
+         @param  name   The name of the tag to retrieve.
+         @return    The tag that match with the name.
+         */
+        static sTag create(string&& name) noexcept;
+        
+        //! Tag creator.
+        /** This function retrieves the tag of a literal, the hash of its name has been computed at compile time. The names used by the library are built in, their tags are constant objects that are never allocated, locked or counted, so retrieving them only looks up a small constant table. Their control blocks are created once and never released.
+         @param  literal    The literal of the tag to retrieve.
+         @return    The tag that match with the literal.
+         */
+        static sTag create(Literal const& literal) noexcept;
+        
+        //! Tag retriever.
+        /** This function retrieves or creates a tag like the create function does but returns a reference to the tag instead of a shared pointer, so the lookups of the same tags by many threads don't share the writes of a reference count. The tags owned by the table and the built-in tags live until the end of the program, a tag that can be reclaimed is only kept by the cache of the thread until the next lookups of the thread, so keep its shared pointer with create to use it longer.
+         @param  name   The name of the tag to retrieve.
+         @return    The tag that match with the name.
+         */
+        static Tag const& get(string_view name) noexcept;
         
         class List;
     };
     
+    inline Tag::Literal::operator sTag() const noexcept
+    {
+        return Tag::create(*this);
+    }
+    
+    inline sTag Tag::Literal::operator->() const noexcept
+    {
+        return Tag::create(*this);
+    }
+    
+    //! Creates a tag literal.
+    /** The suffix creates a literal whose hash is computed at compile time, for example "set"_tag.
+     @param name The name.
+     @param size The size of the name.
+     @return The literal.
+     */
+    constexpr inline Tag::Literal operator""_tag(const char* name, const size_t size) noexcept
+    {
+        return Tag::Literal(name, size);
+    }
+    
+    //! Compares a tag with a literal.
+    /** The function compares the hashes and only compares the names when the hashes are equal, so it doesn't look up the tag.
+     @param tag     The tag.
+     @param literal The literal.
+     @return True if the tag has the name of the literal, otherwise false.
+     */
+    inline bool operator==(sTag const& tag, Tag::Literal const& literal) noexcept
+    {
+        return tag && tag->getHash() == literal.getHash() && tag->getName() == literal.getName();
+    }
+    
+    inline bool operator==(Tag::Literal const& literal, sTag const& tag) noexcept
+    {
+        return tag == literal;
+    }
+    
+    inline bool operator!=(sTag const& tag, Tag::Literal const& literal) noexcept
+    {
+        return !(tag == literal);
+    }
+    
+    inline bool operator!=(Tag::Literal const& literal, sTag const& tag) noexcept
+    {
+        return !(tag == literal);
+    }
+    
+    //! Compares two literals.
+    /** The function compares the hashes and only compares the names when the hashes are equal, so the members of Tags can be compared like tags, for example Tags::name == Tags::text.
+     @param lhs The first literal.
+     @param rhs The second literal.
+     @return True if the literals have the same name, otherwise false.
+     */
+    constexpr inline bool operator==(Tag::Literal const& lhs, Tag::Literal const& rhs) noexcept
+    {
+        return lhs.getHash() == rhs.getHash() && lhs.getName() == rhs.getName();
+    }
+    
+    constexpr inline bool operator!=(Tag::Literal const& lhs, Tag::Literal const& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+    
+    inline bool TagLess::operator()(sTag const& lhs, sTag const& rhs) const noexcept
+    {
+        if(lhs == rhs)
+        {
+            return false;
+        }
+        else if(lhs && rhs)
+        {
+            return lhs->m_hash != rhs->m_hash ? lhs->m_hash < rhs->m_hash : lhs->m_name < rhs->m_name;
+        }
+        return !lhs;
+    }
+    
+    inline size_t TagHash::operator()(sTag const& tag) const noexcept
+    {
+        return tag ? size_t(tag->m_hash) : 0;
+    }
+    
+    //! The built-in tags, each one is the member of Tags and its name, in the order of their ids.
+    /** The list generates the members of Tags and the table of the built-in tags, so they can't differ.
+     */
+#define KIWI_BUILTIN_TAGS(TAG) \
+    TAG(_empty,                "") \
+    TAG(arguments,             "arguments") \
+    TAG(Arial,                 "Arial") \
+    TAG(bang,                  "bang") \
+    TAG(bdcolor,               "bdcolor") \
+    TAG(bgcolor,               "bgcolor") \
+    TAG(bold,                  "bold") \
+    TAG(bold_italic,           "bold italic") \
+    TAG(center,                "center") \
+    TAG(color,                 "color") \
+    TAG(Color,                 "Color") \
+    TAG(command,               "command") \
+    TAG(circlecolor,           "circlecolor") \
+    TAG(dsp,                   "dsp") \
+    TAG(from,                  "from") \
+    TAG(focus,                 "focus") \
+    TAG(font,                  "font") \
+    TAG(Font,                  "Font") \
+    TAG(Font_Face,             "Font Face") \
+    TAG(Font_Justification,    "Font Justification") \
+    TAG(Font_Name,             "Font Name") \
+    TAG(Font_Size,             "Font Size") \
+    TAG(fontface,              "fontface") \
+    TAG(fontjustification,     "fontjustification") \
+    TAG(fontname,              "fontname") \
+    TAG(fontsize,              "fontsize") \
+    TAG(gridsize,              "gridsize") \
+    TAG(hidden,                "hidden") \
+    TAG(id,                    "id") \
+    TAG(ignoreclick,           "ignoreclick") \
+    TAG(italic,                "italic") \
+    TAG(ledcolor,              "ledcolor") \
+    TAG(left,                  "left") \
+    TAG(link,                  "link") \
+    TAG(links,                 "links") \
+    TAG(locked_bgcolor,        "locked_bgcolor") \
+    TAG(Menelo,                "Menelo") \
+    TAG(mescolor,              "mescolor") \
+    TAG(Message_Color,         "Message Color") \
+    TAG(name,                  "name") \
+    TAG(newlink,               "newlink") \
+    TAG(newobject,             "newobject") \
+    TAG(ninlets,               "ninlets") \
+    TAG(normal,                "normal") \
+    TAG(noutlets,              "noutlets") \
+    TAG(object,                "object") \
+    TAG(objects,               "objects") \
+    TAG(patcher,               "patcher") \
+    TAG(position,              "position") \
+    TAG(presentation,          "presentation") \
+    TAG(presentation_position, "presentation_position") \
+    TAG(presentation_size,     "presentation_size") \
+    TAG(removelink,            "removelink") \
+    TAG(removeobject,          "removeobject") \
+    TAG(right,                 "right") \
+    TAG(set,                   "set") \
+    TAG(sigcolor,              "sigcolor") \
+    TAG(Signal_Color,          "Signal Color") \
+    TAG(size,                  "size") \
+    TAG(text,                  "text") \
+    TAG(textcolor,             "textcolor") \
+    TAG(to,                    "to") \
+    TAG(unlocked_bgcolor,      "unlocked_bgcolor")
+    
+    //! The tags of the names used by the library.
+    /** The names are literals whose hashes are computed at compile time, so they are constant initialized and they can be used during the static initialization of any translation unit. A literal converts to its built-in tag, which is never allocated, and its members can be accessed with the arrow operator like the ones of a tag.
+     */
     class Tags
     {
     public:
-        static const sTag _empty;
-        static const sTag arguments;
-        static const sTag Arial;
-        
-        static const sTag bang;
-        static const sTag bdcolor;
-        static const sTag bgcolor;
-        static const sTag bold;
-        static const sTag bold_italic;
-        
-        static const sTag center;
-        static const sTag color;
-        static const sTag Color;
-        static const sTag command;
-        static const sTag circlecolor;
-        
-        static const sTag dsp;
-        
-        static const sTag focus;
-        static const sTag font;
-        static const sTag Font;
-        static const sTag Font_Face;
-        static const sTag Font_Justification;
-        static const sTag Font_Name;
-        static const sTag Font_Size;
-        static const sTag fontface;
-        static const sTag fontjustification;
-        static const sTag fontname;
-        static const sTag fontsize;
-        static const sTag from;
-        
-        static const sTag gridsize;
-        
-        static const sTag hidden;
-        
-        static const sTag id;
-        static const sTag ignoreclick;
-        static const sTag italic;
-        
-        static const sTag ledcolor;
-        static const sTag left;
-        static const sTag link;
-        static const sTag links;
-        static const sTag locked_bgcolor;
-        
-        static const sTag Menelo;
-        static const sTag mescolor;
-        static const sTag Message_Color;
-        
-        static const sTag name;
-        static const sTag newlink;
-        static const sTag newobject;
-        static const sTag ninlets;
-        static const sTag normal;
-        static const sTag noutlets;
-        
-        static const sTag object;
-        static const sTag objects;
-        
-        static const sTag patcher;
-        static const sTag position;
-        static const sTag presentation;
-        static const sTag presentation_position;
-        static const sTag presentation_size;
-        
-        static const sTag removelink;
-        static const sTag removeobject;
-        static const sTag right;
-        
-        static const sTag set;
-        static const sTag sigcolor;
-        static const sTag Signal_Color;
-        static const sTag size;
-        
-        static const sTag text;
-        static const sTag textcolor;
-        static const sTag to;
-        
-        static const sTag unlocked_bgcolor;
-        
+#define KIWI_TAGS_MEMBER(member, name) static constexpr Tag::Literal member = Tag::Literal(name, sizeof(name) - 1);
+        KIWI_BUILTIN_TAGS(KIWI_TAGS_MEMBER)
+#undef KIWI_TAGS_MEMBER
     };
 };
 
@@ -40,16 +40,39 @@
 #include <map>
 #include <list>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <deque>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <sstream>
 #include <typeinfo>
 #include <typeindex>
+#include <functional>
 #include <codecvt>
+#include <charconv>
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <string_view>
 
 #ifdef __APPLE__
 #include <Accelerate/Accelerate.h>
 #endif
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define __KIWI_SSE2__
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 using namespace std;
 
 #define _USE_MATH_DEFINES
@@ -86,10 +109,26 @@ namespace Kiwi
     typedef shared_ptr<Beacon>          sBeacon;
     typedef weak_ptr<Beacon>            wBeacon;
 
+    //! The tag comparator orders the tags by hash and then by name.
+    /** The comparator gives an order that doesn't depend on the addresses of the tags, so the dicos are iterated in the same order from one run to another. The tags being unique, they are only compared when they differ, and the hashes of the names being computed at their creation, the names are only compared when their hashes are equal.
+     */
+    struct TagLess
+    {
+        inline bool operator()(sTag const& lhs, sTag const& rhs) const noexcept;
+    };
+    
+    //! The tag hasher gives the hash of the name of a tag.
+    /** The hasher can be used by the unordered containers of tags, the hashes are computed at the creation of the tags.
+     */
+    struct TagHash
+    {
+        inline size_t operator()(sTag const& tag) const noexcept;
+    };
+    
     typedef unsigned long               ulong;
     typedef shared_ptr<const Tag>       sTag;
     typedef vector<Atom>                Vector;
-    typedef map<sTag, Atom>             Dico;
+    typedef map<sTag, Atom, TagLess>    Dico;
     
     class Error : public exception
     {
@@ -159,6 +198,293 @@ namespace Kiwi
         return new_value;
     }
     
+    //! Computes the hash of a sequence of bytes.
+    /** The function computes the 64 bits FNV-1a hash of a sequence of bytes. The hash only depends on the bytes, so it is stable from one run to another, and it can be computed at compile time.
+     @param data The bytes.
+     @param size The number of bytes.
+     @return The hash.
+     */
+    constexpr inline uint64_t hashBytes(const char* data, const size_t size) noexcept
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for(size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ uint64_t((unsigned char)data[i])) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+    
+    //! Combines a hash with a value.
+    /** The function mixes a value into a hash.
+     @param seed    The hash.
+     @param value   The value.
+     @return The new hash.
+     */
+    inline uint64_t hashCombine(const uint64_t seed, uint64_t value) noexcept
+    {
+        value *= 0x9e3779b97f4a7c15ull;
+        value ^= value >> 32;
+        return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+    }
+    
+    //! Writes a variable-length integer.
+    /** The function appends an unsigned integer to a string with seven bits per byte, the small values only take one byte.
+     @param value   The value.
+     @param output  The string.
+     */
+    inline void writeVarint(uint64_t value, string& output)
+    {
+        while(value >= 0x80)
+        {
+            output += char((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        output += char(value);
+    }
+    
+    //! Reads a variable-length integer.
+    /** The function reads an unsigned integer written by writeVarint and moves the data after it.
+     @param data    The data.
+     @param end     The end of the data.
+     @param value   The value.
+     @return False if the integer is truncated or too long, otherwise true.
+     */
+    inline bool readVarint(const char*& data, const char* end, uint64_t& value) noexcept
+    {
+        value = 0;
+        for(unsigned shift = 0; shift < 64 && data != end; shift += 7)
+        {
+            const unsigned char byte = (unsigned char)*data++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if(!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    //! Reads a file.
+    /** The function reads the whole content of a file in one block.
+     @param path The path of the file.
+     @return The content of the file.
+     */
+    inline string readFile(string const& path)
+    {
+        ifstream file(path, ios::in | ios::binary);
+        if(!file.is_open())
+        {
+            throw Error("Can't open the file " + path);
+        }
+        string text;
+        file.seekg(0, ios::end);
+        const streamoff size = file.tellg();
+        if(size > 0)
+        {
+            text.resize(size_t(size));
+            file.seekg(0, ios::beg);
+            file.read(&text[0], size);
+        }
+        if(file.bad())
+        {
+            throw Error("Can't read the file " + path);
+        }
+        return text;
+    }
+    
+    //! A pool of threads that runs tasks.
+    /** The pool keeps its threads until it is destroyed, so the parallel functions don't create threads at each call. A thread that waits for its own tasks can run the tasks of the queue meanwhile, so the tasks can also use the pool without blocking it.
+     */
+    class ThreadPool
+    {
+    private:
+        mutex                   m_mutex;
+        condition_variable      m_condition;
+        deque<function<void()>> m_tasks;
+        vector<thread>          m_threads;
+        bool                    m_stop;
+        
+        void work()
+        {
+            unique_lock<mutex> lock(m_mutex);
+            while(true)
+            {
+                m_condition.wait(lock, [this](){return m_stop || !m_tasks.empty();});
+                if(m_tasks.empty())
+                {
+                    return;
+                }
+                function<void()> task = move(m_tasks.front());
+                m_tasks.pop_front();
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+        }
+        
+    public:
+        
+        //! Constructor.
+        /** Creates a pool and starts its threads.
+         @param nthreads The number of threads.
+         */
+        ThreadPool(const ulong nthreads) : m_stop(false)
+        {
+            m_threads.reserve(nthreads);
+            for(ulong i = 0; i < nthreads; i++)
+            {
+                m_threads.emplace_back(&ThreadPool::work, this);
+            }
+        }
+        
+        //! Destructor.
+        /** Runs the remaining tasks and stops the threads.
+         */
+        ~ThreadPool()
+        {
+            {
+                lock_guard<mutex> guard(m_mutex);
+                m_stop = true;
+            }
+            m_condition.notify_all();
+            for(auto& thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+        
+        //! Retrieves the pool shared by the library.
+        /** The pool has one thread less than the hardware, the thread that uses it being the last one.
+         @return The pool.
+         */
+        static ThreadPool& global()
+        {
+            static ThreadPool pool(max(ulong(thread::hardware_concurrency()), 2ul) - 1ul);
+            return pool;
+        }
+        
+        //! Retrieves the number of threads.
+        inline ulong getNumberOfThreads() const noexcept {return ulong(m_threads.size());}
+        
+        //! Adds a task to the queue.
+        /** The task must not throw.
+         @param task The task.
+         */
+        void push(function<void()> task)
+        {
+            {
+                lock_guard<mutex> guard(m_mutex);
+                m_tasks.push_back(move(task));
+            }
+            m_condition.notify_one();
+        }
+        
+        //! Runs a task of the queue on the calling thread.
+        /** The function runs the first task of the queue if there is one.
+         @return False if the queue is empty, otherwise true.
+         */
+        bool runOne()
+        {
+            function<void()> task;
+            {
+                lock_guard<mutex> guard(m_mutex);
+                if(m_tasks.empty())
+                {
+                    return false;
+                }
+                task = move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+            return true;
+        }
+    };
+    
+    //! Calls a function over a range of indices on several threads.
+    /** The function splits the range [0, size) into contiguous blocks, one per thread, and calls the function with the bounds of each block on the threads of the global pool. The calling thread processes the first block itself, then runs the tasks of the pool until all the blocks have been processed. If the function throws, the other blocks are still processed and the first exception is thrown again when they are all done.
+     @param size        The number of indices.
+     @param function    The function to call with the first and the last (excluded) index of a block.
+     @param nthreads    The maximum number of threads, zero means the number of threads of the pool plus the calling thread.
+     */
+    template <class Function> void parallelFor(const ulong size, Function&& function, ulong nthreads = 0ul)
+    {
+        ThreadPool& pool = ThreadPool::global();
+        if(!nthreads)
+        {
+            nthreads = pool.getNumberOfThreads() + 1ul;
+        }
+        nthreads = min(nthreads, size);
+        if(nthreads < 2ul)
+        {
+            if(size)
+            {
+                function(0ul, size);
+            }
+            return;
+        }
+        
+        mutex               state_mutex;
+        condition_variable  state_condition;
+        ulong               remaining = nthreads - 1ul;
+        exception_ptr       error;
+        auto run = [&function, &state_mutex, &error](const ulong begin, const ulong end)
+        {
+            try
+            {
+                function(begin, end);
+            }
+            catch(...)
+            {
+                lock_guard<mutex> guard(state_mutex);
+                if(!error)
+                {
+                    error = current_exception();
+                }
+            }
+        };
+        
+        const ulong block = size / nthreads;
+        const ulong extra = size % nthreads;
+        ulong begin = block + (extra ? 1ul : 0ul);
+        for(ulong i = 1; i < nthreads; i++)
+        {
+            const ulong end = begin + block + (i < extra ? 1ul : 0ul);
+            pool.push([&run, &state_mutex, &state_condition, &remaining, begin, end]()
+            {
+                run(begin, end);
+                lock_guard<mutex> guard(state_mutex);
+                if(--remaining == 0ul)
+                {
+                    state_condition.notify_all();
+                }
+            });
+            begin = end;
+        }
+        run(0ul, block + (extra ? 1ul : 0ul));
+        
+        // the blocks that are still in the queue are processed by the calling thread too
+        while(true)
+        {
+            {
+                lock_guard<mutex> guard(state_mutex);
+                if(!remaining)
+                {
+                    break;
+                }
+            }
+            if(!pool.runOne())
+            {
+                unique_lock<mutex> lock(state_mutex);
+                state_condition.wait(lock, [&remaining](){return !remaining;});
+                break;
+            }
+        }
+        if(error)
+        {
+            rethrow_exception(error);
+        }
+    }
+    
     inline string trimDecimal(string& text)
     {
         string::size_type pos = text.find('.');
@@ -216,38 +542,124 @@ namespace Kiwi
         return to_string(__val);
     }
     
-    inline string toString(float __val, bool trim = true)
+#if !defined(__cpp_lib_to_chars)
+    // The standard libraries that don't convert the floating-point numbers with charconv, like the older libc++ of Apple, use the C functions instead.
+    
+    //! Reads a floating-point number with the C function of its type, so it is rounded only once.
+    template<class T> inline T strtoFloating(const char* text, char** end) noexcept
     {
-        if(trim)
+        if constexpr(is_same<T, float>::value)
         {
-            string text = to_string(__val);
-            return trimDecimal(text);
+            return strtof(text, end);
+        }
+        else if constexpr(is_same<T, double>::value)
+        {
+            return strtod(text, end);
         }
         else
         {
-            return to_string(__val);
+            return strtold(text, end);
         }
     }
     
-    inline string toString(double __val, bool trim = true)
+    //! Retrieves the smallest number of significant digits that reads back to exactly the same value.
+    template<class T> inline int getShortestPrecision(const T value) noexcept
     {
-        if(trim)
+        char buffer[64];
+        int precision = 1;
+        for(; precision < numeric_limits<T>::max_digits10; precision++)
         {
-            string text = to_string(__val);
-            return trimDecimal(text);
+            snprintf(buffer, sizeof(buffer), "%.*Le", precision - 1, (long double)value);
+            if(strtoFloating<T>(buffer, nullptr) == value)
+            {
+                break;
+            }
         }
-        else
+        return precision;
+    }
+    
+    //! Writes a text formatted by snprintf if it fits in the buffer.
+    inline char* copyChars(char* first, char* last, const char* text, const int size) noexcept
+    {
+        if(size < 0 || size > last - first)
         {
-            return to_string(__val);
+            return first;
         }
+        memcpy(first, text, size_t(size));
+        return first + size;
     }
+#endif
     
-    inline string toString(long double __val, bool trim = true)
+    //! Writes a floating-point number in its shortest round-trip form.
+    /** The function writes the shortest text that reads back to exactly the same value, using the scientific notation only when it is shorter.
+     @param first   The beginning of the buffer, it should be able to hold 48 characters.
+     @param last    The end of the buffer.
+     @param value   The value.
+     @return The end of the written text.
+     */
+    template<class T> inline char* toChars(char* first, char* last, const T value) noexcept
+    {
+#if defined(__cpp_lib_to_chars)
+        const to_chars_result result = to_chars(first, last, value);
+        return result.ec == errc() ? result.ptr : first;
+#else
+        char buffer[64];
+        const int size = snprintf(buffer, sizeof(buffer), "%.*Lg", getShortestPrecision(value), (long double)value);
+        return copyChars(first, last, buffer, size);
+#endif
+    }
+    
+    //! Writes a floating-point number in its shortest round-trip form with the fixed notation.
+    /** The function writes the shortest text without exponent that reads back to exactly the same value, it is the form read by Atom::parse. The largest and the smallest doubles take more than 300 characters.
+     @param first   The beginning of the buffer.
+     @param last    The end of the buffer.
+     @param value   The value.
+     @return The end of the written text or the beginning if the buffer is too small.
+     */
+    template<class T> inline char* toCharsFixed(char* first, char* last, const T value) noexcept
+    {
+#if defined(__cpp_lib_to_chars)
+        const to_chars_result result = to_chars(first, last, value, chars_format::fixed);
+        return result.ec == errc() ? result.ptr : first;
+#else
+        // the number of decimals follows from the significant digits and the exponent of the shortest form
+        char buffer[64];
+        const int precision = getShortestPrecision(value);
+        snprintf(buffer, sizeof(buffer), "%.*Le", precision - 1, (long double)value);
+        const char* exponent = strchr(buffer, 'e');
+        const int decimals = exponent ? max(0, precision - 1 - atoi(exponent + 1)) : 0;
+        const int size = snprintf(first, size_t(last - first), "%.*Lf", decimals, (long double)value);
+        return size >= 0 && size < last - first ? first + size : first;
+#endif
+    }
+    
+    //! Checks if a formatted floating-point number looks like an integer.
+    /** The function checks if the text has neither a decimal point nor an exponent and isn't infinite or nan.
+     @param first   The beginning of the text.
+     @param last    The end of the text.
+     @return True if the text would be read back as an integer.
+     */
+    inline bool isIntegral(const char* first, const char* last) noexcept
+    {
+        return find_if(first, last, [](const char c) {return c == '.' || c == 'e' || c == 'n';}) == last;
+    }
+    
+    template<class T> inline string toStringFloating(const T __val, bool trim)
     {
         if(trim)
         {
-            string text = to_string(__val);
-            return trimDecimal(text);
+            // the shortest fixed notation because Atom::parse doesn't read exponents, only the long doubles too large for the buffer use the scientific notation
+            char buffer[400];
+            char* end = toCharsFixed(buffer, buffer + sizeof(buffer) - 1, __val);
+            if(end == buffer)
+            {
+                end = toChars(buffer, buffer + sizeof(buffer) - 1, __val);
+            }
+            if(isIntegral(buffer, end))
+            {
+                *end++ = '.';
+            }
+            return string(buffer, end);
         }
         else
         {
@@ -255,182 +667,375 @@ namespace Kiwi
         }
     }
     
-    template<class T> inline T fromString(string const& __val)
+    inline string toString(float __val, bool trim = true)
     {
-        return T();
+        return toStringFloating(__val, trim);
     }
     
-    template<> inline bool fromString(string const& __val)
+    inline string toString(double __val, bool trim = true)
     {
-        string::size_type pos = __val.find_first_of("-0123456789");
-        if(pos != string::npos)
+        return toStringFloating(__val, trim);
+    }
+    
+    inline string toString(long double __val, bool trim = true)
+    {
+        return toStringFloating(__val, trim);
+    }
+    
+    //! The result of the conversion of a text into a number.
+    /** The conversion holds the value, the status and the position where the conversion stopped. It converts to true if the conversion succeeded.
+     */
+    template<class T> struct Conversion
+    {
+        T           value;  ///< The value, or zero if the conversion failed.
+        errc        status; ///< The status, errc::invalid_argument if the text isn't a number and errc::result_out_of_range if the value can't be represented.
+        const char* end;    ///< The first character that isn't part of the number.
+        
+        inline operator bool() const noexcept {return status == errc();}
+    };
+    
+    //! Converts a text into a number.
+    /** The function converts a text into a number without allocating memory and without throwing exceptions. The text can start with a sign but can't contain white spaces. The booleans are read from "true", "false" or from an integer.
+     @param text    The text.
+     @param partial If false, the whole text must be a number, if true the conversion stops at the first character that isn't part of the number.
+     @return The conversion.
+     */
+    template<class T> inline Conversion<T> fromChars(string_view text, const bool partial = false) noexcept
+    {
+        const char* first = text.data();
+        const char* last  = text.data() + text.size();
+        if(first != last && *first == '+' && last - first > 1 && first[1] != '-')
         {
-            return (bool)stol(__val.c_str()+pos);
+            ++first;
+        }
+        Conversion<T> result{T(), errc(), first};
+#if !defined(__cpp_lib_to_chars)
+        if constexpr(is_floating_point<T>::value)
+        {
+            // strtold skips the white spaces and reads the hexadecimal numbers, from_chars doesn't
+            const char* digits = (first != last && *first == '-') ? first + 1 : first;
+            if(digits == last || isspace((unsigned char)*digits))
+            {
+                result.status = errc::invalid_argument;
+                return result;
+            }
+            ulong size = ulong(last - first);
+            if(last - digits > 1 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X'))
+            {
+                size = ulong(digits - first) + 1ul;
+            }
+            char buffer[512];
+            string text;
+            const char* copy = buffer;
+            if(size < sizeof(buffer))
+            {
+                memcpy(buffer, first, size);
+                buffer[size] = '\0';
+            }
+            else
+            {
+                text.assign(first, size);
+                copy = text.c_str();
+            }
+            char* end;
+            errno = 0;
+            result.value = strtoFloating<T>(copy, &end);
+            // the subnormal numbers also set ERANGE but they are represented
+            result.end      = first + (end - copy);
+            result.status   = end == copy ? errc::invalid_argument : ((errno == ERANGE && (result.value == T() || isinf(result.value))) ? errc::result_out_of_range : errc());
         }
         else
+#endif
         {
-            return false;
+            const from_chars_result conversion = from_chars(first, last, result.value);
+            result.end      = conversion.ptr;
+            result.status   = conversion.ec;
         }
-    }
-    
-    template<> inline int fromString(string const& __val)
-    {
-        string::size_type pos = __val.find_first_of("-0123456789");
-        if(pos != string::npos)
+        if(result.status == errc() && !partial && result.end != last)
         {
-            return stoi(__val.c_str()+pos);
+            result.status = errc::invalid_argument;
         }
-        else
+        if(result.status != errc())
         {
-            return 0;
+            result.value = T();
         }
+        return result;
     }
     
-    template<> inline long fromString(string const& __val)
+    template<> inline Conversion<bool> fromChars(string_view text, const bool partial) noexcept
     {
-        string::size_type pos = __val.find_first_of("-0123456789");
-        if(pos != string::npos)
+        if(text.substr(0, 4) == "true" && (partial || text.size() == 4))
         {
-            return stol(__val.c_str()+pos);
+            return Conversion<bool>{true, errc(), text.data() + 4};
         }
-        else
+        else if(text.substr(0, 5) == "false" && (partial || text.size() == 5))
         {
-            return 0;
+            return Conversion<bool>{false, errc(), text.data() + 5};
         }
+        const Conversion<long long> conversion = fromChars<long long>(text, partial);
+        return Conversion<bool>{conversion.value != 0, conversion.status, conversion.end};
     }
     
-    template<> inline ulong fromString(string const& __val)
+    template<class T> inline T fromStringPrefix(string const& __val, const char* digits)
     {
-        string::size_type pos = __val.find_first_of("0123456789");
+        string::size_type pos = __val.find_first_of(digits);
         if(pos != string::npos)
         {
-            return stoul(__val.c_str()+pos);
+            return fromChars<T>(string_view(__val).substr(pos), true).value;
         }
         else
         {
-            return 0;
+            return T();
         }
     }
     
+    template<class T> inline T fromString(string const& __val)
+    {
+        return T();
+    }
+    
+    template<> inline bool fromString(string const& __val)
+    {
+        return fromStringPrefix<long>(__val, "-0123456789") != 0;
+    }
+    
+    template<> inline int fromString(string const& __val)
+    {
+        return fromStringPrefix<int>(__val, "-0123456789");
+    }
+    
+    template<> inline long fromString(string const& __val)
+    {
+        return fromStringPrefix<long>(__val, "-0123456789");
+    }
+    
+    template<> inline ulong fromString(string const& __val)
+    {
+        return fromStringPrefix<ulong>(__val, "0123456789");
+    }
+    
     template<> inline long long fromString(string const& __val)
     {
-        string::size_type pos = __val.find_first_of("-0123456789");
-        if(pos != string::npos)
-        {
-            return stoll(__val.c_str()+pos);
-        }
-        else
-        {
-            return 0;
-        }
+        return fromStringPrefix<long long>(__val, "-0123456789");
     }
     
     template<> inline unsigned long long fromString(string const& __val)
     {
-        string::size_type pos = __val.find_first_of("0123456789");
-        if(pos != string::npos)
-        {
-            return stoull(__val.c_str()+pos);
-        }
-        else
-        {
-            return 0;
-        }
+        return fromStringPrefix<unsigned long long>(__val, "0123456789");
     }
     
     template<> inline float fromString(string const& __val)
     {
-        string::size_type pos = __val.find_first_of("-0123456789.");
-        if(pos != string::npos)
-        {
-            return stof(__val.c_str()+pos);
-        }
-        else
-        {
-            return 0;
-        }
+        return fromStringPrefix<float>(__val, "-0123456789.");
     }
     
     template<> inline double fromString(string const& __val)
     {
-        string::size_type pos = __val.find_first_of("-0123456789.");
-        if(pos != string::npos)
+        return fromStringPrefix<double>(__val, "-0123456789.");
+    }
+    
+    template<> inline long double fromString(string const& __val)
+    {
+        return fromStringPrefix<long double>(__val, "-0123456789.");
+    }
+    
+    //! Retrieves the index of the lowest bit set in a mask.
+    /** The function retrieves the index of the lowest bit set in a non-zero mask.
+     @param mask The mask.
+     @return The index of the bit.
+     */
+    inline ulong lowestBit(const unsigned mask) noexcept
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return ulong(__builtin_ctz(mask));
+#endif
+    }
+    
+    //! Finds the first character of a text that must be escaped in json.
+    /** The function finds the first control character, quote, backslash or slash of a text. It scans the text by blocks of 32 or 16 characters when AVX2 or SSE2 are available.
+     @param first The beginning of the text.
+     @param last  The end of the text.
+     @return The first character to escape or the end of the text.
+     */
+    inline const char* jsonFindEscape(const char* first, const char* last) noexcept
+    {
+#if defined(__AVX2__)
+        const __m256i controls  = _mm256_set1_epi8(0x1F);
+        const __m256i quotes    = _mm256_set1_epi8('\"');
+        const __m256i slashes   = _mm256_set1_epi8('/');
+        const __m256i backs     = _mm256_set1_epi8('\\');
+        for(; last - first >= 32; first += 32)
         {
-            return stod(__val.c_str()+pos);
+            const __m256i chars = _mm256_loadu_si256((const __m256i *)first);
+            const __m256i found = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(chars, controls), controls),
+                                                                  _mm256_cmpeq_epi8(chars, quotes)),
+                                                  _mm256_or_si256(_mm256_cmpeq_epi8(chars, slashes),
+                                                                  _mm256_cmpeq_epi8(chars, backs)));
+            const unsigned mask = unsigned(_mm256_movemask_epi8(found));
+            if(mask)
+            {
+                return first + lowestBit(mask);
+            }
         }
-        else
+#elif defined(__KIWI_SSE2__)
+        const __m128i controls  = _mm_set1_epi8(0x1F);
+        const __m128i quotes    = _mm_set1_epi8('\"');
+        const __m128i slashes   = _mm_set1_epi8('/');
+        const __m128i backs     = _mm_set1_epi8('\\');
+        for(; last - first >= 16; first += 16)
+        {
+            const __m128i chars = _mm_loadu_si128((const __m128i *)first);
+            const __m128i found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(chars, controls), controls),
+                                                            _mm_cmpeq_epi8(chars, quotes)),
+                                               _mm_or_si128(_mm_cmpeq_epi8(chars, slashes),
+                                                            _mm_cmpeq_epi8(chars, backs)));
+            const unsigned mask = unsigned(_mm_movemask_epi8(found));
+            if(mask)
+            {
+                return first + lowestBit(mask);
+            }
+        }
+#endif
+        for(; first != last; ++first)
         {
-            return 0;
+            const unsigned char c = (unsigned char)*first;
+            if(c < 0x20 || c == '\"' || c == '/' || c == '\\')
+            {
+                return first;
+            }
         }
+        return last;
     }
     
-    template<> inline long double fromString(string const& __val)
+    //! Finds the first quote or backslash of a text.
+    /** The function finds the first quote or backslash of a text. It scans the text by blocks of 32 or 16 characters when AVX2 or SSE2 are available.
+     @param first The beginning of the text.
+     @param last  The end of the text.
+     @return The first quote or backslash or the end of the text.
+     */
+    inline const char* jsonFindUnescape(const char* first, const char* last) noexcept
     {
-        string::size_type pos = __val.find_first_of("-0123456789.");
-        if(pos != string::npos)
+#if defined(__AVX2__)
+        const __m256i quotes    = _mm256_set1_epi8('\"');
+        const __m256i backs     = _mm256_set1_epi8('\\');
+        for(; last - first >= 32; first += 32)
         {
-            return stold(__val.c_str()+pos);
+            const __m256i chars = _mm256_loadu_si256((const __m256i *)first);
+            const unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chars, quotes), _mm256_cmpeq_epi8(chars, backs))));
+            if(mask)
+            {
+                return first + lowestBit(mask);
+            }
         }
-        else
+#elif defined(__KIWI_SSE2__)
+        const __m128i quotes    = _mm_set1_epi8('\"');
+        const __m128i backs     = _mm_set1_epi8('\\');
+        for(; last - first >= 16; first += 16)
+        {
+            const __m128i chars = _mm_loadu_si128((const __m128i *)first);
+            const unsigned mask = unsigned(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, quotes), _mm_cmpeq_epi8(chars, backs))));
+            if(mask)
+            {
+                return first + lowestBit(mask);
+            }
+        }
+#endif
+        for(; first != last; ++first)
         {
-            return 0;
+            if(*first == '\"' || *first == '\\')
+            {
+                return first;
+            }
         }
+        return last;
     }
     
-    static inline string jsonEscape(string const& text)
+    //! Appends a text escaped and quoted for json to a buffer.
+    /** The function appends the text to the buffer between quotes and escapes the special characters. The runs of characters that don't need to be escaped are copied in bulk.
+     @param text    The text.
+     @param output  The buffer.
+     */
+    static inline void jsonEscape(string_view text, string& output)
     {
-        ostringstream ss;
-        for(auto iter = text.cbegin(); iter != text.cend(); iter++)
+        const char* first = text.data();
+        const char* last  = text.data() + text.size();
+        output.reserve(output.size() + text.size() + 2);
+        output += '\"';
+        while(first != last)
         {
-            switch (*iter)
+            const char* next = jsonFindEscape(first, last);
+            output.append(first, next);
+            if(next == last)
+            {
+                break;
+            }
+            switch(*next)
             {
-                case '\\': ss << "\\\\"; break;
-                case '"': ss << "\\\""; break;
-                case '/': ss << "\\/"; break;
-                case '\b': ss << "\\b"; break;
-                case '\f': ss << "\\f"; break;
-                case '\n': ss << "\\n"; break;
-                case '\r': ss << "\\r"; break;
-                case '\t': ss << "\\t"; break;
-                default: ss << *iter; break;
+                case '\\': output += "\\\\"; break;
+                case '"': output += "\\\""; break;
+                case '/': output += "\\/"; break;
+                case '\b': output += "\\b"; break;
+                case '\f': output += "\\f"; break;
+                case '\n': output += "\\n"; break;
+                case '\r': output += "\\r"; break;
+                case '\t': output += "\\t"; break;
+                default: output += *next; break;
             }
+            first = next + 1;
         }
-        return '\"' + ss.str() + '\"';
+        output += '\"';
     }
     
-    static inline string jsonUnescape(string const& text)
+    static inline string jsonEscape(string const& text)
     {
-        bool state = false;
-        ostringstream ss;
-        for(auto iter = text.cbegin(); iter != text.cend(); iter++)
+        string output;
+        jsonEscape(string_view(text), output);
+        return output;
+    }
+    
+    //! Appends a json text unescaped to a buffer.
+    /** The function appends the text to the buffer and replaces the escape sequences by their characters. It stops at the first quote that isn't escaped. The runs of characters without escape sequences are copied in bulk.
+     @param text    The text.
+     @param output  The buffer.
+     */
+    static inline void jsonUnescape(string_view text, string& output)
+    {
+        const char* first = text.data();
+        const char* last  = text.data() + text.size();
+        output.reserve(output.size() + text.size());
+        while(first != last)
         {
-            if(state)
+            const char* next = jsonFindUnescape(first, last);
+            output.append(first, next);
+            if(next == last || *next == '\"' || ++next == last)
             {
-                switch(*iter)
-                {
-                    case '"': ss << '\"'; break;
-                    case '/': ss << '/'; break;
-                    case 'b': ss << '\b'; break;
-                    case 'f': ss << '\f'; break;
-                    case 'n': ss << '\n'; break;
-                    case 'r': ss << '\r'; break;
-                    case 't': ss << '\t'; break;
-                    case '\\': ss << '\\'; break;
-                    default: ss << *iter; break;
-                }
-                state = false;
+                break;
             }
-            else
+            switch(*next)
             {
-                switch(*iter)
-                {
-                    case '"': return ss.str();
-                    case '\\': state = true; break;
-                    default: ss << *iter; break;
-                }
+                case '"': output += '\"'; break;
+                case '/': output += '/'; break;
+                case 'b': output += '\b'; break;
+                case 'f': output += '\f'; break;
+                case 'n': output += '\n'; break;
+                case 'r': output += '\r'; break;
+                case 't': output += '\t'; break;
+                case '\\': output += '\\'; break;
+                default: output += *next; break;
             }
+            first = next + 1;
         }
-        return ss.str();
+    }
+    
+    static inline string jsonUnescape(string const& text)
+    {
+        string output;
+        jsonUnescape(string_view(text), output);
+        return output;
     }
     
 };
@@ -0,0 +1,837 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiWire.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define KIWI_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define KIWI_SEND_FLAGS 0
+#endif
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                  WIRE ENCODER                                    //
+    // ================================================================================ //
+    
+    void Wire::Encoder::writeTag(sTag const& tag, string& output)
+    {
+        const uint32_t id = tag->getId();
+        if(id < m_indices.size() && m_indices[id])
+        {
+            output += char(TagIndex);
+            writeVarint(m_indices[id] - 1u, output);
+            return;
+        }
+        const string_view name = tag->getName();
+        if(name.size() > maxTagSize)
+        {
+            m_failed = true;
+            return;
+        }
+        if(m_tags.size() < maxTags && m_size + name.size() <= maxTagsSize)
+        {
+            if(id >= m_indices.size())
+            {
+                m_indices.resize(id + 1ul, 0u);
+            }
+            m_indices[id] = uint32_t(m_tags.size() + 1ul);
+            m_tags.push_back(tag);
+            m_size += name.size();
+            output += char(TagNew);
+        }
+        else
+        {
+            output += char(TagLiteral);
+        }
+        writeVarint(name.size(), output);
+        output += name;
+    }
+    
+    void Wire::Encoder::writeAtom(Atom const& atom, string& output)
+    {
+        if(++m_atoms > maxAtoms)
+        {
+            m_failed = true;
+            return;
+        }
+        switch(atom.getType())
+        {
+            case Atom::BOOLEAN:
+                output += char(bool(atom) ? True : False);
+                break;
+            case Atom::LONG:
+            {
+                const int64_t value = long(atom);
+                output += char(Long);
+                writeVarint((uint64_t(value) << 1) ^ uint64_t(value >> 63), output);
+                break;
+            }
+            case Atom::DOUBLE:
+            {
+                const double value = atom;
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                output += char(Double);
+                for(int i = 0; i < 8; i++)
+                {
+                    output += char((bits >> (i * 8)) & 0xff);
+                }
+                break;
+            }
+            case Atom::TAG:
+                writeTag(atom, output);
+                break;
+            case Atom::VECTOR:
+            {
+                Kiwi::Vector const& atoms = atom.getVector();
+                output += char(Vector);
+                writeVarint(atoms.size(), output);
+                for(auto const& it : atoms)
+                {
+                    writeAtom(it, output);
+                }
+                break;
+            }
+            case Atom::DICO:
+            {
+                Kiwi::Dico const& dico = atom.getDico();
+                output += char(Dico);
+                writeVarint(dico.size(), output);
+                for(auto const& it : dico)
+                {
+                    writeTag(it.first, output);
+                    writeAtom(it.second, output);
+                }
+                break;
+            }
+            default:
+                output += char(Undefined);
+                break;
+        }
+    }
+    
+    bool Wire::Encoder::encode(Kiwi::Vector const& atoms, string& output)
+    {
+        const string::size_type header = output.size();
+        m_mark = m_tags.size();
+        m_atoms = 0ul;
+        m_failed = false;
+        output.append(4, '\0');
+        writeVarint(atoms.size(), output);
+        for(auto const& atom : atoms)
+        {
+            writeAtom(atom, output);
+        }
+        const ulong size = ulong(output.size() - header - 4);
+        if(m_failed || size > maxFrameSize)
+        {
+            // The decoder would reject the frame and drop the connection.
+            output.resize(header);
+            rollback();
+            return false;
+        }
+        for(int i = 0; i < 4; i++)
+        {
+            output[header + i] = char((size >> (i * 8)) & 0xff);
+        }
+        return true;
+    }
+    
+    void Wire::Encoder::rollback() noexcept
+    {
+        while(m_tags.size() > m_mark)
+        {
+            m_indices[m_tags.back()->getId()] = 0u;
+            m_size -= m_tags.back()->getName().size();
+            m_tags.pop_back();
+        }
+    }
+    
+    void Wire::Encoder::clear() noexcept
+    {
+        m_indices.clear();
+        m_tags.clear();
+        m_size = 0ul;
+        m_mark = 0ul;
+    }
+    
+    // ================================================================================ //
+    //                                  WIRE DECODER                                    //
+    // ================================================================================ //
+    
+    ulong Wire::Decoder::frameSize(const char* data) noexcept
+    {
+        ulong size = 0ul;
+        for(int i = 0; i < 4; i++)
+        {
+            size |= ulong((unsigned char)data[i]) << (i * 8);
+        }
+        return size;
+    }
+    
+    bool Wire::Decoder::readTag(const unsigned char code, const char*& data, const char* end, sTag& tag)
+    {
+        uint64_t value;
+        if(!readVarint(data, end, value))
+        {
+            return false;
+        }
+        if(code == TagIndex)
+        {
+            if(value >= m_tags.size())
+            {
+                return false;
+            }
+            tag = m_tags[value];
+            return true;
+        }
+        else if(code == TagNew || code == TagLiteral)
+        {
+            // the encoder only sends a tag by name once its dictionary is full
+            const bool full = m_tags.size() >= maxTags || m_size + value > maxTagsSize;
+            if(value > uint64_t(end - data) || value > maxTagSize || full != (code == TagLiteral))
+            {
+                return false;
+            }
+            tag = Tag::create(data, size_t(value));
+            data += value;
+            if(code == TagNew)
+            {
+                m_tags.push_back(tag);
+                m_size += ulong(value);
+            }
+            return true;
+        }
+        return false;
+    }
+    
+    bool Wire::Decoder::readAtom(const char*& data, const char* end, Atom& atom, const ulong depth)
+    {
+        if(data == end || depth > 256ul || ++m_atoms > maxAtoms)
+        {
+            return false;
+        }
+        const unsigned char code = (unsigned char)*data++;
+        switch(code)
+        {
+            case Undefined:
+                atom = Atom();
+                return true;
+            case False:
+            case True:
+                atom = Atom(code == True);
+                return true;
+            case Long:
+            {
+                uint64_t value;
+                if(!readVarint(data, end, value))
+                {
+                    return false;
+                }
+                atom = Atom(long(int64_t(value >> 1) ^ -int64_t(value & 1)));
+                return true;
+            }
+            case Double:
+            {
+                if(end - data < 8)
+                {
+                    return false;
+                }
+                uint64_t bits = 0;
+                for(int i = 0; i < 8; i++)
+                {
+                    bits |= uint64_t((unsigned char)data[i]) << (i * 8);
+                }
+                data += 8;
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                atom = Atom(value);
+                return true;
+            }
+            case TagIndex:
+            case TagNew:
+            case TagLiteral:
+            {
+                sTag tag;
+                if(!readTag(code, data, end, tag))
+                {
+                    return false;
+                }
+                atom = Atom(tag);
+                return true;
+            }
+            case Vector:
+            {
+                uint64_t size;
+                if(!readVarint(data, end, size) || size > uint64_t(end - data))
+                {
+                    return false;
+                }
+                // The size comes from the peer, the atoms are only created as they are read.
+                Kiwi::Vector atoms;
+                atoms.reserve(size_t(min(size, uint64_t(1024))));
+                for(uint64_t i = 0; i < size; i++)
+                {
+                    atoms.emplace_back();
+                    if(!readAtom(data, end, atoms.back(), depth + 1))
+                    {
+                        return false;
+                    }
+                }
+                atom = Atom(move(atoms));
+                return true;
+            }
+            case Dico:
+            {
+                uint64_t size;
+                if(!readVarint(data, end, size) || size > uint64_t(end - data))
+                {
+                    return false;
+                }
+                Kiwi::Dico dico;
+                for(uint64_t i = 0; i < size; i++)
+                {
+                    sTag key;
+                    Atom value;
+                    if(data == end || !readTag((unsigned char)*data++, data, end, key) || !readAtom(data, end, value, depth + 1))
+                    {
+                        return false;
+                    }
+                    dico[key] = move(value);
+                }
+                atom = Atom(move(dico));
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+    
+    bool Wire::Decoder::decode(const char* data, const ulong size, Kiwi::Vector& atoms)
+    {
+        const char* end = data + size;
+        uint64_t count;
+        if(!readVarint(data, end, count) || count > uint64_t(end - data))
+        {
+            return false;
+        }
+        m_atoms = 0ul;
+        atoms.clear();
+        atoms.reserve(size_t(min(count, uint64_t(1024))));
+        for(uint64_t i = 0; i < count; i++)
+        {
+            atoms.emplace_back();
+            if(!readAtom(data, end, atoms.back(), 0ul))
+            {
+                return false;
+            }
+        }
+        return data == end;
+    }
+    
+    void Wire::Decoder::clear() noexcept
+    {
+        m_tags.clear();
+        m_size = 0ul;
+    }
+    
+    // ================================================================================ //
+    //                                  WIRE SOCKET                                     //
+    // ================================================================================ //
+    
+    Wire::Socket::Socket(const int socket) noexcept :
+    m_socket(socket),
+    m_output_pos(0ul),
+    m_input_pos(0ul)
+    {
+        if(m_socket >= 0)
+        {
+            fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+            const int value = 1;
+            setsockopt(m_socket, SOL_SOCKET, SO_NOSIGPIPE, &value, sizeof(value));
+#endif
+        }
+    }
+    
+    Wire::Socket::~Socket() noexcept
+    {
+        close();
+    }
+    
+    Wire::sSocket Wire::Socket::connect(string const& path)
+    {
+        sockaddr_un address;
+        if(path.size() >= sizeof(address.sun_path))
+        {
+            return sSocket();
+        }
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path.c_str(), path.size());
+        
+        const int socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(socket < 0)
+        {
+            return sSocket();
+        }
+        if(::connect(socket, (sockaddr *)&address, sizeof(address)) != 0)
+        {
+            ::close(socket);
+            return sSocket();
+        }
+        return make_shared<Socket>(socket);
+    }
+    
+    bool Wire::Socket::send(Kiwi::Vector const& atoms)
+    {
+        if(!flush() || m_output.size() - m_output_pos > maxOutputSize)
+        {
+            return false;
+        }
+        if(!m_encoder.encode(atoms, m_output))
+        {
+            return false;
+        }
+        return flush();
+    }
+    
+    bool Wire::Socket::flush()
+    {
+        if(m_socket < 0)
+        {
+            return false;
+        }
+        while(m_output_pos < m_output.size())
+        {
+            const ssize_t written = ::send(m_socket, m_output.data() + m_output_pos, m_output.size() - m_output_pos, KIWI_SEND_FLAGS);
+            if(written < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+                if(errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    close();
+                    return false;
+                }
+                // the written bytes are removed once they take most of the buffer
+                if(m_output_pos >= 65536ul && m_output_pos * 2ul >= m_output.size())
+                {
+                    m_output.erase(0, m_output_pos);
+                    m_output_pos = 0ul;
+                }
+                return true;
+            }
+            m_output_pos += ulong(written);
+        }
+        m_output.clear();
+        m_output_pos = 0ul;
+        return true;
+    }
+    
+    bool Wire::Socket::receive(function<void(Kiwi::Vector&)> callback)
+    {
+        if(m_socket < 0)
+        {
+            return false;
+        }
+        char buffer[65536];
+        Kiwi::Vector atoms;
+        while(true)
+        {
+            const ssize_t size = ::recv(m_socket, buffer, sizeof(buffer), 0);
+            if(size < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if(size <= 0)
+            {
+                return size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            }
+            
+            // the frames are decoded as the bytes arrive so the input only holds the last incomplete frame
+            m_input.append(buffer, size_t(size));
+            while(m_input.size() - m_input_pos >= 4)
+            {
+                const ulong frame = Decoder::frameSize(m_input.data() + m_input_pos);
+                if(frame > maxFrameSize)
+                {
+                    return false;
+                }
+                if(m_input.size() - m_input_pos - 4 < frame)
+                {
+                    break;
+                }
+                if(!m_decoder.decode(m_input.data() + m_input_pos + 4, frame, atoms))
+                {
+                    return false;
+                }
+                m_input_pos += 4 + frame;
+                callback(atoms);
+                atoms.clear();
+            }
+            if(m_input_pos)
+            {
+                m_input.erase(0, m_input_pos);
+                m_input_pos = 0ul;
+            }
+        }
+    }
+    
+    void Wire::Socket::close() noexcept
+    {
+        if(m_socket >= 0)
+        {
+            ::close(m_socket);
+            m_socket = -1;
+        }
+        m_output.clear();
+        m_output_pos = 0ul;
+    }
+    
+    // ================================================================================ //
+    //                                  WIRE SERVER                                     //
+    // ================================================================================ //
+    
+    Wire::Server::~Server() noexcept
+    {
+        close();
+    }
+    
+    bool Wire::Server::listen(string const& path)
+    {
+        close();
+        sockaddr_un address;
+        if(path.size() >= sizeof(address.sun_path))
+        {
+            return false;
+        }
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path.c_str(), path.size());
+        
+        m_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(m_socket < 0)
+        {
+            return false;
+        }
+        unlink(path.c_str());
+        if(::bind(m_socket, (sockaddr *)&address, sizeof(address)) != 0 || ::listen(m_socket, SOMAXCONN) != 0)
+        {
+            ::close(m_socket);
+            m_socket = -1;
+            return false;
+        }
+        fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+        m_path = path;
+        return true;
+    }
+    
+    Wire::sSocket Wire::Server::accept()
+    {
+        if(m_socket >= 0)
+        {
+            const int socket = ::accept(m_socket, nullptr, nullptr);
+            if(socket >= 0)
+            {
+                return make_shared<Socket>(socket);
+            }
+        }
+        return sSocket();
+    }
+    
+    void Wire::Server::close() noexcept
+    {
+        if(m_socket >= 0)
+        {
+            ::close(m_socket);
+            m_socket = -1;
+            unlink(m_path.c_str());
+            m_path.clear();
+        }
+    }
+    
+    // ================================================================================ //
+    //                                      WIRE RING                                   //
+    // ================================================================================ //
+    
+    struct Wire::Ring::Header
+    {
+        static const uint32_t magicNumber = 0x4b525731;
+        
+        alignas(64) atomic<uint64_t>    head;
+        alignas(64) atomic<uint64_t>    tail;
+        alignas(64) atomic<uint32_t>    waiting;
+        atomic<uint32_t>                signal;
+        uint64_t                        capacity;
+        atomic<uint32_t>                magic;
+    };
+    
+    static_assert(atomic<uint64_t>::is_always_lock_free && atomic<uint32_t>::is_always_lock_free, "The ring needs lock-free atomics to be shared between processes.");
+    
+    Wire::Ring::Ring() noexcept :
+    m_file(-1),
+    m_memory(nullptr),
+    m_size(0ul),
+    m_header(nullptr),
+    m_data(nullptr),
+    m_capacity(0ul),
+    m_owner(false)
+    {
+        ;
+    }
+    
+    Wire::Ring::~Ring() noexcept
+    {
+        close();
+    }
+    
+    bool Wire::Ring::map(const ulong size)
+    {
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+        if(memory == MAP_FAILED)
+        {
+            return false;
+        }
+        m_memory    = memory;
+        m_size      = size;
+        m_header    = static_cast<Header*>(memory);
+        m_data      = static_cast<char*>(memory) + sizeof(Header);
+        return true;
+    }
+    
+    bool Wire::Ring::create(string const& name, const ulong capacity)
+    {
+        close();
+        ulong size = 64ul;
+        while(size < capacity)
+        {
+            size <<= 1;
+        }
+        shm_unlink(name.c_str());
+        m_file = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if(m_file < 0)
+        {
+            return false;
+        }
+        m_name  = name;
+        m_owner = true;
+        if(ftruncate(m_file, off_t(sizeof(Header) + size)) != 0 || !map(sizeof(Header) + size))
+        {
+            close();
+            return false;
+        }
+        m_header->head.store(0ull, memory_order_relaxed);
+        m_header->tail.store(0ull, memory_order_relaxed);
+        m_header->waiting.store(0u, memory_order_relaxed);
+        m_header->signal.store(0u, memory_order_relaxed);
+        m_header->capacity = size;
+        m_header->magic.store(Header::magicNumber, memory_order_release);
+        m_capacity = size;
+        return true;
+    }
+    
+    bool Wire::Ring::open(string const& name)
+    {
+        close();
+        m_file = shm_open(name.c_str(), O_RDWR, 0600);
+        if(m_file < 0)
+        {
+            return false;
+        }
+        struct stat infos;
+        if(fstat(m_file, &infos) != 0 || ulong(infos.st_size) <= sizeof(Header) || !map(ulong(infos.st_size)))
+        {
+            close();
+            return false;
+        }
+        m_name = name;
+        const uint64_t capacity = m_header->capacity;
+        if(m_header->magic.load(memory_order_acquire) != Header::magicNumber || capacity != m_size - sizeof(Header) || (capacity & (capacity - 1)))
+        {
+            close();
+            return false;
+        }
+        m_capacity = ulong(capacity);
+        return true;
+    }
+    
+    void Wire::Ring::read(const ulong position, char* data, const ulong size) const noexcept
+    {
+        const ulong offset = position & (m_capacity - 1);
+        const ulong first  = min(size, m_capacity - offset);
+        memcpy(data, m_data + offset, first);
+        memcpy(data + first, m_data, size - first);
+    }
+    
+    bool Wire::Ring::send(Kiwi::Vector const& atoms)
+    {
+        if(!m_header)
+        {
+            return false;
+        }
+        m_frame.clear();
+        if(!m_encoder.encode(atoms, m_frame))
+        {
+            return false;
+        }
+        
+        const uint64_t head = m_header->head.load(memory_order_relaxed);
+        const uint64_t tail = m_header->tail.load(memory_order_acquire);
+        if(m_frame.size() > m_capacity - ulong(head - tail))
+        {
+            // The frame hasn't been sent so the tags it introduced must be sent again.
+            m_encoder.rollback();
+            return false;
+        }
+        
+        const ulong offset = ulong(head) & (m_capacity - 1);
+        const ulong first  = min(ulong(m_frame.size()), m_capacity - offset);
+        memcpy(m_data + offset, m_frame.data(), first);
+        memcpy(m_data, m_frame.data() + first, m_frame.size() - first);
+        m_header->head.store(head + m_frame.size(), memory_order_release);
+        
+        atomic_thread_fence(memory_order_seq_cst);
+        if(m_header->waiting.load(memory_order_relaxed))
+        {
+            m_header->signal.fetch_add(1u, memory_order_release);
+#ifdef __linux__
+            syscall(SYS_futex, &m_header->signal, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif
+        }
+        return true;
+    }
+    
+    bool Wire::Ring::receive(function<void(Kiwi::Vector&)> callback)
+    {
+        if(!m_header)
+        {
+            return false;
+        }
+        Kiwi::Vector atoms;
+        uint64_t tail = m_header->tail.load(memory_order_relaxed);
+        const uint64_t head = m_header->head.load(memory_order_acquire);
+        while(head - tail >= 4)
+        {
+            char header[4];
+            read(ulong(tail), header, 4ul);
+            const ulong size = Decoder::frameSize(header);
+            if(size > head - tail - 4)
+            {
+                return false;
+            }
+            const ulong offset = ulong(tail + 4) & (m_capacity - 1);
+            const char* data = m_data + offset;
+            if(offset + size > m_capacity)
+            {
+                m_buffer.resize(size);
+                read(ulong(tail + 4), &m_buffer[0], size);
+                data = m_buffer.data();
+            }
+            if(!m_decoder.decode(data, size, atoms))
+            {
+                return false;
+            }
+            tail += 4 + size;
+            m_header->tail.store(tail, memory_order_release);
+            callback(atoms);
+            atoms.clear();
+        }
+        return true;
+    }
+    
+    bool Wire::Ring::wait(const ulong ms)
+    {
+        if(!m_header)
+        {
+            return false;
+        }
+        const uint64_t tail = m_header->tail.load(memory_order_relaxed);
+        if(m_header->head.load(memory_order_acquire) != tail)
+        {
+            return true;
+        }
+        const uint32_t signal = m_header->signal.load(memory_order_acquire);
+        m_header->waiting.store(1u, memory_order_seq_cst);
+        if(m_header->head.load(memory_order_seq_cst) == tail)
+        {
+#ifdef __linux__
+            timespec timeout;
+            timeout.tv_sec  = time_t(ms / 1000ul);
+            timeout.tv_nsec = long(ms % 1000ul) * 1000000l;
+            syscall(SYS_futex, &m_header->signal, FUTEX_WAIT, signal, &timeout, nullptr, 0);
+#else
+            const auto end = chrono::steady_clock::now() + chrono::milliseconds(ms);
+            while(m_header->signal.load(memory_order_acquire) == signal && chrono::steady_clock::now() < end)
+            {
+                this_thread::sleep_for(chrono::microseconds(50));
+            }
+#endif
+        }
+        m_header->waiting.store(0u, memory_order_relaxed);
+        return m_header->head.load(memory_order_acquire) != tail;
+    }
+    
+    void Wire::Ring::close() noexcept
+    {
+        if(m_memory)
+        {
+            munmap(m_memory, m_size);
+            m_memory = nullptr;
+            m_header = nullptr;
+            m_data   = nullptr;
+            m_size   = 0ul;
+        }
+        if(m_file >= 0)
+        {
+            ::close(m_file);
+            m_file = -1;
+        }
+        if(m_owner)
+        {
+            shm_unlink(m_name.c_str());
+            m_owner = false;
+        }
+        m_name.clear();
+        m_capacity = 0ul;
+        m_encoder.clear();
+        m_decoder.clear();
+    }
+}
@@ -0,0 +1,391 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#ifndef __DEF_KIWI_WIRE__
+#define __DEF_KIWI_WIRE__
+
+#include "KiwiAtom.h"
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                      WIRE                                        //
+    // ================================================================================ //
+    
+    //! The wire exchanges vectors of atoms between processes in a binary format.
+    /** A message is a frame made of its size on four bytes followed by its atoms. The numbers are written as variable-length integers or raw doubles, and each side of a session keeps a dictionary of the tags already sent, so a tag name is only sent the first time and then costs the few bytes of its index.
+     @see Wire::Encoder, Wire::Decoder, Wire::Socket
+     */
+    class Wire
+    {
+    public:
+        class Encoder;
+        class Decoder;
+        class Socket;
+        class Server;
+        class Ring;
+        typedef shared_ptr<Socket>  sSocket;
+        typedef shared_ptr<Server>  sServer;
+        
+        //! The maximum size of a frame.
+        static const ulong maxFrameSize = 1ul << 26;
+        
+        //! The maximum number of tags in the dictionary of a session.
+        static const ulong maxTags = 1ul << 16;
+        
+        //! The maximum size of the names of the tags in the dictionary of a session.
+        static const ulong maxTagsSize = 1ul << 24;
+        
+        //! The maximum size of the name of a tag.
+        static const ulong maxTagSize = 1ul << 16;
+        
+        //! The maximum number of atoms in a frame, the atoms of the vectors and the dicos included.
+        static const ulong maxAtoms = 1ul << 20;
+        
+        //! The maximum size of the frames waiting to be written by a socket.
+        static const ulong maxOutputSize = 1ul << 26;
+        
+        enum Code
+        {
+            Undefined   = 0,
+            False       = 1,
+            True        = 2,
+            Long        = 3,
+            Double      = 4,
+            TagIndex    = 5,
+            TagNew      = 6,
+            TagLiteral  = 7,
+            Vector      = 8,
+            Dico        = 9
+        };
+    };
+    
+    // ================================================================================ //
+    //                                  WIRE ENCODER                                    //
+    // ================================================================================ //
+    
+    //! The encoder writes the frames of a session.
+    /** The encoder writes vectors of atoms into frames and remembers the tags it has sent in an array indexed by the ids of the tags. Once the dictionary holds maxTags tags or maxTagsSize bytes of names, the new tags are sent by name each time. The frames must be decoded in the same order by a single decoder.
+     */
+    class Wire::Encoder
+    {
+    private:
+        vector<uint32_t>    m_indices;
+        vector<sTag>        m_tags;
+        ulong               m_size;
+        ulong               m_mark;
+        ulong               m_atoms;
+        bool                m_failed;
+        
+        void writeTag(sTag const& tag, string& output);
+        void writeAtom(Atom const& atom, string& output);
+    
+    public:
+    
+        //! Constructor.
+        inline Encoder() noexcept : m_size(0ul), m_mark(0ul), m_atoms(0ul), m_failed(false) {}
+        
+        //! Destructor.
+        inline ~Encoder() noexcept {}
+        
+        //! Appends a frame.
+        /** The function appends the frame of a vector of atoms to a buffer. If the frame, its number of atoms or the name of one of its tags exceeds the maximum accepted by the decoder, the buffer and the session are left unchanged.
+         @param atoms   The vector of atoms.
+         @param output  The buffer.
+         @return False if the frame or a name is too large, otherwise true.
+         */
+        bool encode(Kiwi::Vector const& atoms, string& output);
+        
+        //! Forgets the last frame.
+        /** The function forgets the tags introduced by the last frame, it must be called if the frame has been dropped before reaching the decoder.
+         */
+        void rollback() noexcept;
+        
+        //! Resets the session.
+        /** The function forgets the tags sent, the decoder must be reset too.
+         */
+        void clear() noexcept;
+    };
+    
+    // ================================================================================ //
+    //                                  WIRE DECODER                                    //
+    // ================================================================================ //
+    
+    //! The decoder reads the frames of a session.
+    /** The decoder reads the frames written by an encoder, in the same order, and rebuilds the dictionary of the tags. The peer may be untrusted: the dictionary is bounded like the one of the encoder, the tags sent by name are only accepted once it is full, the atoms are only created as they are read and their number is bounded by maxAtoms, and a frame that breaks these rules is malformed. The tags received by name are still created in the table, use the reclaim mode to release them.
+     @see Tag::setReclaim
+     */
+    class Wire::Decoder
+    {
+    private:
+        vector<sTag>    m_tags;
+        ulong           m_size;
+        ulong           m_atoms;
+        
+        bool readTag(const unsigned char code, const char*& data, const char* end, sTag& tag);
+        bool readAtom(const char*& data, const char* end, Atom& atom, const ulong depth);
+    
+    public:
+    
+        //! Constructor.
+        inline Decoder() noexcept : m_size(0ul), m_atoms(0ul) {}
+        
+        //! Destructor.
+        inline ~Decoder() noexcept {}
+        
+        //! Reads the size of a frame.
+        /** The function reads the size of the frame at the beginning of a buffer.
+         @param data The buffer, it must hold at least four bytes.
+         @return The size of the frame without its header.
+         */
+        static ulong frameSize(const char* data) noexcept;
+        
+        //! Decodes the content of a frame.
+        /** The function decodes the content of a frame, without its size.
+         @param data    The content of the frame.
+         @param size    The size of the content.
+         @param atoms   The vector that receives the atoms.
+         @return False if the frame is malformed, otherwise true.
+         */
+        bool decode(const char* data, const ulong size, Kiwi::Vector& atoms);
+        
+        //! Resets the session.
+        /** The function forgets the tags received.
+         */
+        void clear() noexcept;
+    };
+    
+    // ================================================================================ //
+    //                                  WIRE SOCKET                                     //
+    // ================================================================================ //
+    
+    //! The socket sends and receives frames over a local stream socket.
+    /** The socket is non-blocking: the frames that can't be written immediately are queued and written by the next calls to send or flush, and receive only reads the bytes available. The queue is bounded by maxOutputSize, when it is full send refuses the frames until the peer has read enough, the descriptor can be watched with poll or select to know when to flush.
+     */
+    class Wire::Socket
+    {
+    private:
+        int         m_socket;
+        Encoder     m_encoder;
+        Decoder     m_decoder;
+        string      m_output;
+        ulong       m_output_pos;
+        string      m_input;
+        ulong       m_input_pos;
+    
+    public:
+    
+        //! Constructor.
+        /** Creates a socket from a connected descriptor, the socket becomes its owner and sets it non-blocking.
+         @param socket The descriptor.
+         */
+        Socket(const int socket) noexcept;
+        
+        //! Destructor.
+        /** Closes the descriptor.
+         */
+        ~Socket() noexcept;
+        
+        //! Connects to a server.
+        /** The function connects to a server listening on a local socket path.
+         @param path The path of the socket.
+         @return The socket or nullptr if the connection failed.
+         */
+        static sSocket connect(string const& path);
+        
+        //! Retrieves the descriptor.
+        /** The function retrieves the descriptor, for example to watch it with poll.
+         @return The descriptor or -1 if the socket is closed.
+         */
+        inline int getDescriptor() const noexcept {return m_socket;}
+        
+        //! Retrieves if frames are waiting to be written.
+        /** The function retrieves if frames are waiting to be written.
+         @return True if frames are waiting, otherwise false.
+         */
+        inline bool hasPendingOutput() const noexcept {return m_output_pos < m_output.size();}
+        
+        //! Sends a vector of atoms.
+        /** The function writes as much of the pending frames as possible without blocking, then encodes a vector of atoms and writes it if the pending frames don't exceed maxOutputSize. If the connection is broken, the socket is closed.
+         @param atoms The vector of atoms.
+         @return False if the connection is broken, if the frame is too large or if too many frames are pending, otherwise true.
+         @see hasPendingOutput, getDescriptor
+         */
+        bool send(Kiwi::Vector const& atoms);
+        
+        //! Writes the pending frames.
+        /** The function writes as much of the pending frames as possible without blocking. If the connection is broken, the socket is closed.
+         @return False if the connection is broken, otherwise true.
+         */
+        bool flush();
+        
+        //! Receives the vectors of atoms.
+        /** The function reads the bytes available without blocking and sends each complete frame to a function.
+         @param callback The function that receives the atoms.
+         @return False if the connection is closed or broken or if a frame is malformed, otherwise true.
+         */
+        bool receive(function<void(Kiwi::Vector&)> callback);
+        
+        //! Closes the socket.
+        void close() noexcept;
+    };
+    
+    // ================================================================================ //
+    //                                  WIRE SERVER                                     //
+    // ================================================================================ //
+    
+    //! The server accepts the connections on a local socket path.
+    /** The server listens on a local socket path in non-blocking mode and creates a socket for each connection.
+     */
+    class Wire::Server
+    {
+    private:
+        int     m_socket;
+        string  m_path;
+    
+    public:
+    
+        //! Constructor.
+        inline Server() noexcept : m_socket(-1) {}
+        
+        //! Destructor.
+        /** Closes the server and removes the socket path.
+         */
+        ~Server() noexcept;
+        
+        //! Listens on a path.
+        /** The function creates the socket path, replacing an existing one, and listens on it.
+         @param path The path of the socket.
+         @return True if the server is listening, otherwise false.
+         */
+        bool listen(string const& path);
+        
+        //! Retrieves the descriptor.
+        /** The function retrieves the descriptor, it becomes readable when a connection is waiting.
+         @return The descriptor or -1 if the server isn't listening.
+         */
+        inline int getDescriptor() const noexcept {return m_socket;}
+        
+        //! Accepts a connection.
+        /** The function accepts a waiting connection without blocking.
+         @return The socket or nullptr if no connection is waiting.
+         */
+        sSocket accept();
+        
+        //! Closes the server.
+        void close() noexcept;
+    };
+    
+    // ================================================================================ //
+    //                                      WIRE RING                                   //
+    // ================================================================================ //
+    
+    //! The ring sends frames from a process to another through shared memory.
+    /** The ring is a single-producer single-consumer circular buffer in a shared memory object. The producer copies the frames into the ring and the consumer decodes them in place, so a message costs no system call while the consumer is busy. When the ring is empty the consumer can sleep in wait, and the producer only wakes it up when it is actually sleeping. One process creates the ring and sends, the other opens it and receives; the tags are mapped by the session dictionary of the wire.
+     */
+    class Wire::Ring
+    {
+    private:
+        struct Header;
+        
+        int         m_file;
+        void*       m_memory;
+        ulong       m_size;
+        Header*     m_header;
+        char*       m_data;
+        ulong       m_capacity;
+        string      m_name;
+        bool        m_owner;
+        Encoder     m_encoder;
+        Decoder     m_decoder;
+        string      m_frame;
+        string      m_buffer;
+        
+        //! Maps the shared memory object.
+        bool map(const ulong size);
+        
+        //! Copies bytes out of the ring.
+        void read(const ulong position, char* data, const ulong size) const noexcept;
+        
+    public:
+        
+        //! Constructor.
+        Ring() noexcept;
+        
+        //! Destructor.
+        /** Closes the ring.
+         */
+        ~Ring() noexcept;
+        
+        //! Creates a ring.
+        /** The function creates a shared memory object, replacing an existing one with the same name.
+         @param name        The name of the shared memory object, it starts with a slash.
+         @param capacity    The size of the ring, rounded up to a power of two.
+         @return True if the ring has been created, otherwise false.
+         */
+        bool create(string const& name, const ulong capacity = 1ul << 20);
+        
+        //! Opens a ring.
+        /** The function opens a ring created by another process.
+         @param name The name of the shared memory object.
+         @return True if the ring has been opened, otherwise false.
+         */
+        bool open(string const& name);
+        
+        //! Retrieves if the ring is open.
+        /** The function retrieves if the ring is open.
+         @return True if the ring is open, otherwise false.
+         */
+        inline bool isOpen() const noexcept {return m_header != nullptr;}
+        
+        //! Sends a vector of atoms.
+        /** The function copies the frame of a vector of atoms into the ring and wakes up the consumer if it's sleeping. The function never blocks.
+         @param atoms The vector of atoms.
+         @return False if the ring hasn't enough free space or if the frame is too large, otherwise true.
+         */
+        bool send(Kiwi::Vector const& atoms);
+        
+        //! Receives the vectors of atoms.
+        /** The function decodes the frames available and sends each of them to a function. The function never blocks.
+         @param callback The function that receives the atoms.
+         @return False if the ring isn't open or if a frame is malformed, otherwise true.
+         */
+        bool receive(function<void(Kiwi::Vector&)> callback);
+        
+        //! Waits for frames.
+        /** The function sleeps until frames are available or the time is elapsed.
+         @param ms The maximum time in milliseconds.
+         @return True if frames are available, otherwise false.
+         */
+        bool wait(const ulong ms);
+        
+        //! Closes the ring.
+        /** The function unmaps the ring, the process that created the ring also removes the shared memory object.
+         */
+        void close() noexcept;
+    };
+}
+
+#endif
+
+
@@ -0,0 +1,387 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiWriter.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <charconv>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                      WRITER                                      //
+    // ================================================================================ //
+    
+    // Creates a new temporary file next to the destination. The file has the mode of the destination if it exists, otherwise the mode of the new files given by the umask.
+    static int openTemporary(string const& path, string& temp)
+    {
+        static atomic<ulong> counter(0ul);
+        struct stat status;
+        const bool exists = stat(path.c_str(), &status) == 0;
+        const ulong seed = ulong(chrono::steady_clock::now().time_since_epoch().count()) ^ (ulong(getpid()) << 20);
+        for(int attempt = 0; attempt < 64; attempt++)
+        {
+            char suffix[24];
+            char* end = to_chars(suffix, suffix + sizeof(suffix), seed + counter++, 16).ptr;
+            temp = path + "." + string(suffix, end) + ".tmp";
+            const int file = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+            if(file >= 0)
+            {
+                if(exists)
+                {
+                    fchmod(file, status.st_mode & 07777);
+                }
+                return file;
+            }
+            if(errno != EEXIST)
+            {
+                break;
+            }
+        }
+        temp.clear();
+        return -1;
+    }
+    
+    // Flushes the directory of a path so that a rename in it survives a crash.
+    static bool syncDirectory(string const& path)
+    {
+        const size_t slash = path.find_last_of('/');
+        const string directory = slash == string::npos ? string(".") : (slash ? path.substr(0, slash) : string("/"));
+        const int file = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if(file < 0)
+        {
+            return false;
+        }
+        const bool success = fsync(file) == 0;
+        return (::close(file) == 0) && success;
+    }
+    
+    Writer::Writer(const ulong chunksize, const ulong maxchunks) :
+    m_chunk_size(max(chunksize, 1ul)),
+    m_max_chunks(max(maxchunks, 2ul)),
+    m_nchunks(0ul),
+    m_file(-1),
+    m_failed(false),
+    m_closing(false),
+    m_stop(false)
+    {
+        setp(nullptr, nullptr);
+    }
+    
+    Writer::~Writer()
+    {
+        close();
+    }
+    
+    bool Writer::open(string const& path, const bool atomic, const bool async)
+    {
+        close();
+        m_path      = path;
+        m_failed    = false;
+        m_stop      = false;
+        if(atomic)
+        {
+            m_file = openTemporary(path, m_temp);
+        }
+        else
+        {
+            m_temp.clear();
+            m_file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        }
+        if(m_file < 0)
+        {
+            return false;
+        }
+        if(async)
+        {
+            m_thread = thread(&Writer::run, this);
+        }
+        return true;
+    }
+    
+    bool Writer::write(Atom const& atom)
+    {
+        if(isOpen())
+        {
+            ostream stream(this);
+            stream << atom;
+            return !m_failed && stream.good();
+        }
+        return false;
+    }
+    
+    bool Writer::close()
+    {
+        if(m_closing)
+        {
+            // the background thread completes the file and sets the result of closeAsync
+            m_thread.join();
+            m_closing = false;
+            reset();
+            return false;
+        }
+        if(!isOpen())
+        {
+            return false;
+        }
+        release();
+        {
+            unique_lock<mutex> lock(m_mutex);
+            if(m_thread.joinable())
+            {
+                m_stop = true;
+                m_condition.notify_all();
+                lock.unlock();
+                m_thread.join();
+            }
+            else
+            {
+                flushChunks(lock);
+            }
+        }
+        const bool success = finish();
+        reset();
+        return success;
+    }
+    
+    future<bool> Writer::closeAsync()
+    {
+        promise<bool> closed;
+        future<bool> result = closed.get_future();
+        if(!isOpen())
+        {
+            closed.set_value(false);
+            return result;
+        }
+        release();
+        unique_lock<mutex> lock(m_mutex);
+        m_closed    = move(closed);
+        m_closing   = true;
+        m_stop      = true;
+        if(!m_thread.joinable())
+        {
+            m_thread = thread(&Writer::run, this);
+        }
+        m_condition.notify_all();
+        return result;
+    }
+    
+    bool Writer::finish()
+    {
+        // the pipes and the sockets can't be flushed to a disk
+        bool success = !m_failed && (fsync(m_file) == 0 || errno == EINVAL);
+        success = (::close(m_file) == 0) && success;
+        m_file = -1;
+        if(!m_temp.empty())
+        {
+            if(success)
+            {
+                success = rename(m_temp.c_str(), m_path.c_str()) == 0;
+            }
+            if(!success)
+            {
+                unlink(m_temp.c_str());
+            }
+            m_temp.clear();
+            if(success)
+            {
+                // the new name is on the disk only once the directory is
+                success = syncDirectory(m_path);
+            }
+        }
+        return success;
+    }
+    
+    void Writer::reset()
+    {
+        m_current.reset();
+        m_free.clear();
+        m_full.clear();
+        m_nchunks = 0ul;
+        setp(nullptr, nullptr);
+    }
+    
+    void Writer::release()
+    {
+        lock_guard<mutex> guard(m_mutex);
+        if(m_current && pptr() != pbase())
+        {
+            m_full.push_back(make_pair(move(m_current), ulong(pptr() - pbase())));
+            m_condition.notify_all();
+        }
+        setp(nullptr, nullptr);
+    }
+    
+    bool Writer::acquire()
+    {
+        unique_lock<mutex> lock(m_mutex);
+        while(!m_current && m_free.empty() && m_nchunks >= m_max_chunks && !m_failed)
+        {
+            if(m_thread.joinable())
+            {
+                m_condition.wait(lock);
+            }
+            else
+            {
+                flushChunks(lock);
+            }
+        }
+        if(m_failed)
+        {
+            return false;
+        }
+        if(!m_current)
+        {
+            if(!m_free.empty())
+            {
+                m_current = move(m_free.back());
+                m_free.pop_back();
+            }
+            else
+            {
+                m_current = Chunk(new char[m_chunk_size]);
+                m_nchunks++;
+            }
+        }
+        setp(m_current.get(), m_current.get() + m_chunk_size);
+        return true;
+    }
+    
+    void Writer::flushChunks(unique_lock<mutex>& lock)
+    {
+        while(!m_full.empty())
+        {
+            vector<pair<Chunk, ulong>> chunks;
+            while(!m_full.empty() && chunks.size() < IOV_MAX)
+            {
+                chunks.push_back(move(m_full.front()));
+                m_full.pop_front();
+            }
+            lock.unlock();
+            
+            if(!m_failed)
+            {
+                vector<iovec> iovs(chunks.size());
+                for(vector<iovec>::size_type i = 0; i < chunks.size(); i++)
+                {
+                    iovs[i].iov_base = chunks[i].first.get();
+                    iovs[i].iov_len  = chunks[i].second;
+                }
+                iovec* iov  = iovs.data();
+                int    niov = int(iovs.size());
+                while(niov)
+                {
+                    const ssize_t written = writev(m_file, iov, niov);
+                    if(written < 0)
+                    {
+                        if(errno == EINTR)
+                        {
+                            continue;
+                        }
+                        m_failed = true;
+                        break;
+                    }
+                    size_t remaining = size_t(written);
+                    while(niov && remaining >= iov->iov_len)
+                    {
+                        remaining -= iov->iov_len;
+                        ++iov;
+                        --niov;
+                    }
+                    if(niov)
+                    {
+                        iov->iov_base = (char *)iov->iov_base + remaining;
+                        iov->iov_len -= remaining;
+                    }
+                }
+            }
+            
+            lock.lock();
+            for(auto& chunk : chunks)
+            {
+                m_free.push_back(move(chunk.first));
+            }
+            m_condition.notify_all();
+        }
+    }
+    
+    void Writer::run()
+    {
+        unique_lock<mutex> lock(m_mutex);
+        while(true)
+        {
+            m_condition.wait(lock, [this](){return m_stop || !m_full.empty();});
+            flushChunks(lock);
+            if(m_stop)
+            {
+                break;
+            }
+        }
+        if(m_closing)
+        {
+            lock.unlock();
+            m_closed.set_value(finish());
+        }
+    }
+    
+    Writer::int_type Writer::overflow(int_type c)
+    {
+        release();
+        if(!isOpen() || !acquire())
+        {
+            return traits_type::eof();
+        }
+        if(!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+    
+    int Writer::sync()
+    {
+        if(!isOpen())
+        {
+            return -1;
+        }
+        release();
+        if(!m_thread.joinable())
+        {
+            unique_lock<mutex> lock(m_mutex);
+            flushChunks(lock);
+        }
+        return m_failed ? -1 : 0;
+    }
+}
+
+
@@ -0,0 +1,139 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#ifndef __DEF_KIWI_WRITER__
+#define __DEF_KIWI_WRITER__
+
+#include "KiwiAtom.h"
+#include <condition_variable>
+#include <future>
+
+namespace Kiwi
+{
+    // ================================================================================ //
+    //                                      WRITER                                      //
+    // ================================================================================ //
+    
+    //! The writer streams atoms to a file.
+    /** The writer serializes the atoms in json into a fixed number of fixed-size chunks and hands the full chunks to the file with vectored writes, so the whole serialized text never sits in memory. The file can be written to a temporary file that replaces the destination only when everything has been written, and the chunks can be written by a background thread so the caller doesn't wait for the disk. The writer is a stream buffer and can be used with any output stream.
+     */
+    class Writer : public streambuf
+    {
+    private:
+        typedef unique_ptr<char[]> Chunk;
+        
+        const ulong             m_chunk_size;
+        const ulong             m_max_chunks;
+        ulong                   m_nchunks;
+        Chunk                   m_current;
+        vector<Chunk>           m_free;
+        deque<pair<Chunk,
+        ulong>>                 m_full;
+        int                     m_file;
+        string                  m_path;
+        string                  m_temp;
+        atomic_bool             m_failed;
+        atomic_bool             m_closing;
+        promise<bool>           m_closed;
+        bool                    m_stop;
+        thread                  m_thread;
+        mutex                   m_mutex;
+        condition_variable      m_condition;
+        
+        //! Moves the current chunk to the full chunks.
+        void release();
+        
+        //! Sets up a new current chunk, waiting for a free chunk if needed.
+        bool acquire();
+        
+        //! Writes the full chunks to the file.
+        void flushChunks(unique_lock<mutex>& lock);
+        
+        //! Flushes and closes the file, then replaces the destination in atomic mode.
+        bool finish();
+        
+        //! Releases the chunks.
+        void reset();
+        
+        //! The function of the background thread.
+        void run();
+    
+    protected:
+    
+        int_type overflow(int_type c) override;
+        
+        int sync() override;
+    
+    public:
+    
+        //! Constructor.
+        /** Creates a writer. The memory used by the writer is bounded by the number of chunks times the size of the chunks.
+         @param chunksize   The size of the chunks in bytes.
+         @param maxchunks   The maximum number of chunks, at least two.
+         */
+        Writer(const ulong chunksize = 65536ul, const ulong maxchunks = 16ul);
+        
+        //! Destructor.
+        /** Closes the file if it's still open, it waits for the end of closeAsync.
+         */
+        ~Writer();
+        
+        //! Opens a file.
+        /** The function opens the file that will receive the text.
+         @param path    The path of the file.
+         @param atomic  If true the text is written to a temporary file that replaces the file when the writer is closed, so the file is never left half-written.
+         @param async   If true the chunks are written by a background thread.
+         @return True if the file has been opened, otherwise false.
+         */
+        bool open(string const& path, const bool atomic = true, const bool async = false);
+        
+        //! Retrieves if a file is open.
+        /** The function retrieves if a file is open.
+         @return True if a file is open, otherwise false.
+         */
+        inline bool isOpen() const noexcept {return !m_closing && m_file >= 0;}
+        
+        //! Writes an atom.
+        /** The function writes an atom in json.
+         @param atom The atom.
+         @return False if an error occured, otherwise true.
+         */
+        bool write(Atom const& atom);
+        
+        //! Closes the file.
+        /** The function writes the remaining text, waits for the background thread, flushes the file to the disk and, in atomic mode, replaces the destination with the temporary file and flushes the directory. If an error occured, the temporary file is removed and the destination is left untouched. The function blocks the caller until the file is on the disk, use closeAsync to close the file from a thread that must not wait. If closeAsync has been called, the function only waits for its end and returns false.
+         @return True if the whole text has been written, otherwise false.
+         */
+        bool close();
+        
+        //! Closes the file in the background.
+        /** The function hands the remaining text, the flush to the disk and the replacement of the destination to the background thread and returns immediately, the thread is started if the writer isn't asynchronous. The writer can't write anymore and it is open again only after a new call to open, that waits for the end of the closing like the destructor.
+         @return The future result of the closing, true if the whole text has been written, otherwise false.
+         */
+        future<bool> closeAsync();
+    };
+}
+
+#endif
+
+
@@ -0,0 +1,118 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+
+using namespace Kiwi;
+
+//! A manager with attributes of the usual types of an object.
+class BenchManager : public Attr::Manager
+{
+public:
+    BenchManager()
+    {
+        createAttr(Tag::create("bgcolor"), "Background Color", "Color", 0.5);
+        createAttr(Tag::create("fontsize"), "Font Size", "Font", 12l);
+        createAttr(Tag::create("fontname"), "Font Name", "Font", Tag::create("Menelo"));
+        createAttr(Tag::create("hidden"), "Hidden", "Appearance", false);
+        createAttr(Tag::create("position"), "Position", "Appearance", 0l);
+        createAttr(Tag::create("size"), "Size", "Appearance", 0l);
+    }
+    
+    bool notify(sAttr) override
+    {
+        return true;
+    }
+};
+
+//! Creates the managers of the objects with the dicos of their saved attributes.
+static vector<pair<Attr::sManager, Dico>> createManagers(const ulong count)
+{
+    vector<pair<Attr::sManager, Dico>> managers(count);
+    for(ulong i = 0; i < count; i++)
+    {
+        managers[i].first = make_shared<BenchManager>();
+        Dico& dico = managers[i].second;
+        dico[Tag::create("bgcolor")] = Atom(double(i % 100ul) / 100.);
+        dico[Tag::create("fontsize")] = Atom(long(8ul + i % 16ul));
+        dico[Tag::create("fontname")] = Atom(Tag::create(i % 2ul ? "Arial" : "Monaco"));
+        dico[Tag::create("hidden")] = Atom(long(i % 2ul));
+        dico[Tag::create("position")] = Atom(long(i));
+        dico[Tag::create("size")] = Atom(long(i % 400ul));
+        dico[Tag::create("unknown")] = Atom(long(i));
+    }
+    return managers;
+}
+
+// Compares the restore of the attributes of objects by Manager::read with the per-key setAttrValue loop and with the parallel read.
+int main()
+{
+    const ulong count = 100000ul;
+    const vector<pair<Attr::sManager, Dico>> looped_managers = createManagers(count);
+    const vector<pair<Attr::sManager, Dico>> read_managers = createManagers(count);
+    const vector<pair<Attr::sManager, Dico>> managers = createManagers(count);
+    
+    auto start = kiwiBenchNow();
+    for(auto const& manager : looped_managers)
+    {
+        for(auto const& it : manager.second)
+        {
+            manager.first->setAttrValue(it.first, it.second);
+        }
+    }
+    const double looped = kiwiBenchElapsed(start);
+    
+    start = kiwiBenchNow();
+    for(auto const& manager : read_managers)
+    {
+        manager.first->read(manager.second);
+    }
+    const double read = kiwiBenchElapsed(start);
+    
+    // the parallel read only refers to the dicos of the objects
+    start = kiwiBenchNow();
+    vector<pair<Attr::sManager, Dico const*>> entries;
+    entries.reserve(managers.size());
+    for(auto const& manager : managers)
+    {
+        entries.emplace_back(manager.first, &manager.second);
+    }
+    Attr::Manager::read(entries);
+    const double parallel = kiwiBenchElapsed(start);
+    
+    ulong mismatches = 0ul;
+    for(auto const* restored : {&looped_managers, &read_managers, &managers})
+    {
+        for(auto const& manager : *restored)
+        {
+            Dico dico;
+            manager.first->write(dico);
+            for(auto const& it : dico)
+            {
+                mismatches += manager.second.at(it.first) != it.second;
+            }
+        }
+    }
+    
+    printf("%lu objects: setAttrValue %.1f ms, read %.1f ms, parallel read %.1f ms on %u threads, %lu mismatches\n", count, looped, read, parallel, thread::hardware_concurrency(), mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiTest.h"
+#include <random>
+
+using namespace Kiwi;
+
+// The formatting of the library before the shortest round-trip form, it loses the decimals beyond the sixth.
+static string toStringFixed(const double value)
+{
+    string text = to_string(value);
+    const string::size_type pos = text.find('.');
+    if(pos != string::npos)
+    {
+        while(text.size() > pos && text.back() == '0')
+        {
+            text.pop_back();
+        }
+    }
+    return text;
+}
+
+// Compares the formatting of the doubles by toString and toJson with the former formatting.
+int main()
+{
+    mt19937_64 generator(20141018ull);
+    uniform_int_distribution<int> exponents(-6, 6);
+    const ulong count = 1000000ul;
+    vector<double> values(count);
+    for(auto& value : values)
+    {
+        value = double(long(generator() % 2000001ull) - 1000000l) * pow(10., exponents(generator));
+    }
+    
+    auto start = kiwiBenchNow();
+    ulong size = 0ul;
+    for(const double value : values)
+    {
+        size += toStringFixed(value).size();
+    }
+    const double fixed = kiwiBenchElapsed(start);
+    kiwiBenchKeep(size);
+    
+    start = kiwiBenchNow();
+    size = 0ul;
+    for(const double value : values)
+    {
+        size += toString(value).size();
+    }
+    const double shortest = kiwiBenchElapsed(start);
+    kiwiBenchKeep(size);
+    
+    start = kiwiBenchNow();
+    ostringstream json;
+    for(const double value : values)
+    {
+        ulong indent = 0ul;
+        Atom::toJson(json, Atom(value), indent);
+    }
+    const double tojson = kiwiBenchElapsed(start);
+    kiwiBenchKeep(json.str().size());
+    
+    printf("%lu doubles: to_string %.1f ms, toString %.1f ms, toJson %.1f ms\n", count, fixed, shortest, tojson);
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiTest.h"
+
+using namespace Kiwi;
+
+// The escaping of the library before the vectorized scans, it goes through a stream character by character.
+static string legacyEscape(string const& text)
+{
+    ostringstream ss;
+    for(auto iter = text.cbegin(); iter != text.cend(); iter++)
+    {
+        switch (*iter)
+        {
+            case '\\': ss << "\\\\"; break;
+            case '"': ss << "\\\""; break;
+            case '/': ss << "\\/"; break;
+            case '\b': ss << "\\b"; break;
+            case '\f': ss << "\\f"; break;
+            case '\n': ss << "\\n"; break;
+            case '\r': ss << "\\r"; break;
+            case '\t': ss << "\\t"; break;
+            default: ss << *iter; break;
+        }
+    }
+    return '\"' + ss.str() + '\"';
+}
+
+static string legacyUnescape(string const& text)
+{
+    bool state = false;
+    ostringstream ss;
+    for(auto iter = text.cbegin(); iter != text.cend(); iter++)
+    {
+        if(state)
+        {
+            switch(*iter)
+            {
+                case '"': ss << '\"'; break;
+                case '/': ss << '/'; break;
+                case 'b': ss << '\b'; break;
+                case 'f': ss << '\f'; break;
+                case 'n': ss << '\n'; break;
+                case 'r': ss << '\r'; break;
+                case 't': ss << '\t'; break;
+                case '\\': ss << '\\'; break;
+                default: ss << *iter; break;
+            }
+            state = false;
+        }
+        else
+        {
+            switch(*iter)
+            {
+                case '"': return ss.str();
+                case '\\': state = true; break;
+                default: ss << *iter; break;
+            }
+        }
+    }
+    return ss.str();
+}
+
+// Measures the escaping of a set of texts with the former and the current functions, the texts are processed a number of times.
+static void measure(const char* name, vector<string> const& texts, const ulong repeat)
+{
+    ulong bytes = 0ul;
+    vector<string> escaped;
+    for(auto const& text : texts)
+    {
+        bytes += text.size();
+        escaped.push_back(jsonEscape(text).substr(1));
+    }
+    bytes *= repeat;
+    
+    ulong size = 0ul;
+    auto start = kiwiBenchNow();
+    for(ulong i = 0; i < repeat; i++)
+    {
+        for(auto const& text : texts)
+        {
+            size += legacyEscape(text).size();
+        }
+    }
+    const double escapeLegacy = kiwiBenchElapsed(start);
+    
+    string output;
+    start = kiwiBenchNow();
+    for(ulong i = 0; i < repeat; i++)
+    {
+        for(auto const& text : texts)
+        {
+            output.clear();
+            jsonEscape(string_view(text), output);
+            size += output.size();
+        }
+    }
+    const double escapeCurrent = kiwiBenchElapsed(start);
+    
+    start = kiwiBenchNow();
+    for(ulong i = 0; i < repeat; i++)
+    {
+        for(auto const& text : escaped)
+        {
+            size += legacyUnescape(text).size();
+        }
+    }
+    const double unescapeLegacy = kiwiBenchElapsed(start);
+    
+    start = kiwiBenchNow();
+    for(ulong i = 0; i < repeat; i++)
+    {
+        for(auto const& text : escaped)
+        {
+            output.clear();
+            jsonUnescape(string_view(text), output);
+            size += output.size();
+        }
+    }
+    const double unescapeCurrent = kiwiBenchElapsed(start);
+    kiwiBenchKeep(size);
+    
+    const double megabytes = double(bytes) / 1000000.;
+    printf("%s: escape %.0f -> %.0f MB/s, unescape %.0f -> %.0f MB/s\n", name, megabytes / escapeLegacy * 1000., megabytes / escapeCurrent * 1000., megabytes / unescapeLegacy * 1000., megabytes / unescapeCurrent * 1000.);
+}
+
+// Compares the escaping of typical tag names and of a long text with the former functions.
+int main()
+{
+    const vector<string> names = {"bgcolor", "presentation_position", "fontname", "Font Justification", "newobject", "ninlets", "textcolor", "unlocked_bgcolor", "metro 120", "a/path/to/a/patch.kiwi"};
+    measure("tag names", names, 100000ul);
+    
+    string text;
+    while(text.size() < 1000000ul)
+    {
+        text += "The message boxes hold long texts, with a \"quote\" from time to time and a few lines.\n";
+    }
+    measure("long text", vector<string>{text}, 20ul);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+
+using namespace Kiwi;
+
+//! Creates the dico of an object of a patch with the usual attributes.
+static Dico createObject(const ulong index, const ulong version)
+{
+    Dico dico;
+    dico[Tags::id]          = Atom(long(index));
+    dico[Tags::text]        = Atom(Tag::create("object/" + toString(long(index % 97ul))));
+    dico[Tags::position]    = Atom(Vector{Atom(double(index % 1000ul) * 1.5), Atom(double(index / 1000ul) * 2.25 + double(version))});
+    dico[Tags::size]        = Atom(Vector{Atom(100.), Atom(20.)});
+    dico[Tags::bgcolor]     = Atom(Vector{Atom(0.75), Atom(0.75), Atom(0.75), Atom(1.)});
+    dico[Tags::textcolor]   = Atom(Vector{Atom(0.), Atom(0.), Atom(0.), Atom(1.)});
+    dico[Tags::fontname]    = Atom(Tags::Menelo);
+    dico[Tags::fontsize]    = Atom(12l);
+    dico[Tags::hidden]      = Atom(false);
+    dico[Tags::ninlets]     = Atom(long(index % 3ul));
+    dico[Tags::noutlets]    = Atom(long(index % 2ul));
+    return dico;
+}
+
+//! Creates the atom of a patch from the dicos of its objects, like a save pass does.
+static Atom createPatch(vector<Dico> const& objects)
+{
+    Vector vector;
+    vector.reserve(objects.size());
+    for(auto const& object : objects)
+    {
+        vector.push_back(Atom(object));
+    }
+    Dico patch;
+    patch[Tags::objects]    = Atom(move(vector));
+    patch[Tags::gridsize]   = Atom(20l);
+    return Atom(move(patch));
+}
+
+//! Saves a patch several times with one object changed before each save, and retrieves the mean time of a save.
+static double resave(vector<Dico> objects, const ulong passes, Atom::Cache* cache, string& text)
+{
+    ostringstream stream;
+    double elapsed = 0.;
+    for(ulong pass = 0; pass <= passes; pass++)
+    {
+        objects[(pass * 7919ul) % objects.size()] = createObject((pass * 7919ul) % objects.size(), pass + 1ul);
+        const Atom patch = createPatch(objects);
+        stream.str(string());
+        ulong indent = 0ul;
+        const auto start = kiwiBenchNow();
+        if(cache)
+        {
+            Atom::toJson(stream, patch, indent, *cache);
+            cache->purge();
+        }
+        else
+        {
+            Atom::toJson(stream, patch, indent);
+        }
+        // the first pass fills the cache
+        elapsed += pass ? kiwiBenchElapsed(start) : 0.;
+    }
+    text = stream.str();
+    return elapsed / double(passes);
+}
+
+// Compares the save of a patch of 50k objects with one object changed between two saves, without cache and with caches of different maximum sizes. The atoms of the patch are created again for each save, so the content hashes are computed by each save too.
+int main()
+{
+    const ulong count = 50000ul, passes = 10ul;
+    vector<Dico> objects;
+    for(ulong i = 0; i < count; i++)
+    {
+        objects.push_back(createObject(i, 0ul));
+    }
+    
+    string expected, text;
+    const double uncached = resave(objects, passes, nullptr, expected);
+    printf("%lu objects: %.1f ms per save without cache\n", count, uncached);
+    ulong mismatches = 0ul;
+    for(const ulong maxsize : {1048576ul, 1ul << 30})
+    {
+        Atom::Cache cache(maxsize);
+        const double cached = resave(objects, passes, &cache, text);
+        mismatches += text != expected;
+        printf("max size %lu: %.1f ms per save, %.1fx faster, %lu entries with %lu KB of text for %lu KB of json\n", maxsize, cached, uncached / cached, cache.size(), cache.getNumberOfBytes() / 1024ul, ulong(expected.size()) / 1024ul);
+    }
+    printf("%lu mismatches\n", mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace Kiwi;
+
+//! Retrieves the current time in nanoseconds, the clock is shared by the processes.
+static long getNanoseconds() noexcept
+{
+    return long(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//! Retrieves a percentile of sorted latencies in microseconds.
+static double getPercentile(vector<long> const& latencies, const double percentile)
+{
+    return latencies.empty() ? 0. : double(latencies[min(latencies.size() - 1ul, ulong(percentile * double(latencies.size())))]) / 1000.;
+}
+
+//! Receives the messages in the child process and prints their latencies.
+static int receiveMessages(string const& name, const ulong count, const char* mode)
+{
+    Wire::Ring ring;
+    if(!ring.open(name))
+    {
+        return 1;
+    }
+    vector<long> latencies;
+    latencies.reserve(count);
+    while(latencies.size() < count)
+    {
+        if(ring.wait(100ul))
+        {
+            ring.receive([&latencies](Vector& atoms)
+            {
+                latencies.push_back(getNanoseconds() - long(atoms[1]));
+            });
+        }
+    }
+    sort(latencies.begin(), latencies.end());
+    printf("%s: latency p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n", mode, getPercentile(latencies, 0.5), getPercentile(latencies, 0.99), getPercentile(latencies, 0.999), double(latencies.back()) / 1000.);
+    fflush(stdout);
+    return 0;
+}
+
+// Measures the throughput and the latency of the messages sent through a ring to another process, streamed and one at a time.
+int main()
+{
+    const string name = "/kiwi-bench-ring-" + toString(long(getpid()));
+    const sTag selector = Tag::create("position"), unit = Tag::create("pixels");
+    for(const ulong count : {1000000ul, 20000ul})
+    {
+        const bool paced = count < 100000ul;
+        Wire::Ring ring;
+        if(!ring.create(name))
+        {
+            return 1;
+        }
+        fflush(stdout);
+        const pid_t child = fork();
+        if(child == 0)
+        {
+            _exit(receiveMessages(name, count, paced ? "paced" : "stream"));
+        }
+        
+        ulong full = 0ul;
+        const auto start = kiwiBenchNow();
+        for(ulong i = 0; i < count; i++)
+        {
+            if(paced)
+            {
+                // one message every 20 microseconds so that the consumer sleeps between them
+                const long next = getNanoseconds() + 20000l;
+                while(getNanoseconds() < next)
+                {
+                    this_thread::yield();
+                }
+            }
+            const Vector message = {Atom(selector), Atom(getNanoseconds()), Atom(long(i % 1920ul)), Atom(double(i % 1080ul) * 0.5), Atom(unit)};
+            while(!ring.send(message))
+            {
+                full++;
+                this_thread::yield();
+            }
+        }
+        int status = -1;
+        waitpid(child, &status, 0);
+        const double elapsed = kiwiBenchElapsed(start);
+        printf("%s: %lu messages in %.1f ms (%.2f M messages/s), the ring was full %lu times\n", paced ? "paced" : "stream", count, elapsed, double(count) / elapsed / 1000., full);
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
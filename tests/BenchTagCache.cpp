@@ -0,0 +1,127 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include <random>
+#include <thread>
+
+using namespace Kiwi;
+
+//! Retrieves the tags of a list of names and the share of the retrievals served by the cache of the thread, the built-in tags aren't counted.
+static double createTags(vector<string> const& names, double& rate)
+{
+    const Tag::Stats before = Tag::getStats();
+    const auto start = kiwiBenchNow();
+    for(auto const& name : names)
+    {
+        kiwiBenchKeep(Tag::create(string_view(name)));
+    }
+    const double elapsed = kiwiBenchElapsed(start);
+    const Tag::Stats after = Tag::getStats();
+    rate = double(after.cached - before.cached) / double(after.hits + after.misses - before.hits - before.misses);
+    return elapsed;
+}
+
+//! Retrieves the same few tags on several threads, with shared pointers or with references, and retrieves the time per lookup in nanoseconds.
+static double shareTags(vector<string> const& names, const ulong nthreads, const ulong count, const bool references)
+{
+    vector<thread> threads;
+    const auto start = kiwiBenchNow();
+    for(ulong i = 0; i < nthreads; i++)
+    {
+        threads.emplace_back([&names, count, references, i]()
+        {
+            for(ulong j = 0; j < count; j++)
+            {
+                string const& name = names[(i + j) % names.size()];
+                if(references)
+                {
+                    kiwiBenchKeep(Tag::get(name).getId());
+                }
+                else
+                {
+                    kiwiBenchKeep(Tag::create(string_view(name)));
+                }
+            }
+        });
+    }
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+    return kiwiBenchElapsed(start) * 1e6 / double(nthreads * count);
+}
+
+// Measures the hit rate of the cache of the thread on the names of a patch, a few selectors and attributes with a long tail of object names, against names spread over a large table.
+int main()
+{
+    mt19937_64 generator(20141018ull);
+    const vector<string> selectors = {"set", "bang", "position", "size", "color", "bgcolor", "fontsize", "fontname", "text", "hidden", "id", "from", "to", "link", "object", "patcher"};
+    const ulong count = 2000000ul, objects = 2000ul;
+    
+    // the objects are picked with a zipf-like law so that some of them receive most of the messages
+    vector<double> weights(objects);
+    for(ulong i = 0; i < objects; i++)
+    {
+        weights[i] = 1. / double(i + 1ul);
+    }
+    discrete_distribution<ulong> object(weights.begin(), weights.end());
+    vector<string> patch;
+    for(ulong i = 0; patch.size() < count; i++)
+    {
+        patch.push_back("object/" + toString(long(object(generator))));
+        patch.push_back(selectors[generator() % 4ul]);
+        patch.push_back(selectors[4ul + generator() % (selectors.size() - 4ul)]);
+        if(i % 50ul == 0ul)
+        {
+            patch.push_back("unique/" + toString(long(i)));
+        }
+    }
+    double patchRate;
+    const double patchTime = createTags(patch, patchRate);
+    printf("patch mix: %.1f%% cache hits, %.1f ns per tag\n", patchRate * 100., patchTime * 1e6 / double(patch.size()));
+    
+    // the same number of names spread uniformly over a table that fits in the caches of the processor or not
+    for(const ulong spread : {4096ul, 100000ul})
+    {
+        vector<string> table;
+        for(ulong i = 0; i < spread; i++)
+        {
+            Tag::create("object/" + toString(long(i)));
+        }
+        for(ulong i = 0; i < patch.size(); i++)
+        {
+            table.push_back("object/" + toString(long(generator() % spread)));
+        }
+        double tableRate;
+        const double tableTime = createTags(table, tableRate);
+        printf("spread over %lu tags: %.1f%% cache hits, %.1f ns per tag, the patch mix is %.1fx faster\n", spread, tableRate * 100., tableTime * 1e6 / double(table.size()), tableTime / patchTime);
+    }
+    
+    // the hits on the same tags by several threads, the shared pointers write the same reference counts and the references don't
+    const ulong nthreads = max(ulong(thread::hardware_concurrency()), 4ul);
+    const vector<string> hot(selectors.begin(), selectors.begin() + 8);
+    const double shared = shareTags(hot, nthreads, count, false);
+    const double referenced = shareTags(hot, nthreads, count, true);
+    printf("%lu threads on %lu tags: %.1f ns per shared pointer, %.1f ns per reference, %.1fx faster\n", nthreads, ulong(hot.size()), shared, referenced, shared / referenced);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+
+using namespace Kiwi;
+
+//! The tag table before the sharding, an ordered map behind a single lock.
+class OldTable
+{
+public:
+    struct OldTag
+    {
+        const string name;
+        OldTag(string const& name) : name(name) {}
+    };
+    
+    map<string, shared_ptr<OldTag>> m_tags;
+    mutex                           m_mutex;
+    
+    shared_ptr<OldTag> create(string const& name)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        auto it = m_tags.find(name);
+        if(it != m_tags.end())
+        {
+            return it->second;
+        }
+        shared_ptr<OldTag> tag = make_shared<OldTag>(name);
+        m_tags[name] = tag;
+        return tag;
+    }
+};
+
+//! Runs a function on several threads and retrieves the elapsed time in milliseconds.
+template<class Function> static double runThreads(const ulong nthreads, Function&& function)
+{
+    vector<thread> threads;
+    const auto start = kiwiBenchNow();
+    for(ulong i = 0; i < nthreads; i++)
+    {
+        threads.emplace_back(function, i);
+    }
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+    return kiwiBenchElapsed(start);
+}
+
+// Compares the creation of tags by several threads with the old table, nine retrievals of a shared set of names for one new name.
+int main()
+{
+    const ulong count = 400000ul, shared = 20000ul;
+    vector<string> names;
+    for(ulong i = 0; i < shared; i++)
+    {
+        names.push_back("object/attribute/" + toString(long(i)));
+    }
+    
+    OldTable table;
+    ulong round = 0ul;
+    for(const ulong nthreads : {1ul, 2ul, 4ul, 8ul, 16ul, 32ul})
+    {
+        const ulong operations = count / nthreads;
+        auto work = [&names, operations, nthreads, round](const ulong thread, auto&& create)
+        {
+            string name;
+            ulong seed = thread * 7919ul + 1ul;
+            for(ulong i = 0; i < operations; i++)
+            {
+                seed = seed * 6364136223846793005ul + 1442695040888963407ul;
+                if(i % 10ul == 9ul)
+                {
+                    name = "unique/" + toString(long(round)) + "/" + toString(long(thread)) + "/" + toString(long(i));
+                    kiwiBenchKeep(create(name));
+                }
+                else
+                {
+                    kiwiBenchKeep(create(names[(seed >> 33) % names.size()]));
+                }
+            }
+        };
+        const double old = runThreads(nthreads, [&work, &table](const ulong thread)
+        {
+            work(thread, [&table](string const& name){return table.create(name);});
+        });
+        const double sharded = runThreads(nthreads, [&work](const ulong thread)
+        {
+            work(thread, [](string const& name){return Tag::create(name);});
+        });
+        printf("%2lu threads: old %.1f ms (%.2f M/s), sharded %.1f ms (%.2f M/s), %.1fx\n", nthreads, old, double(count) / old / 1000., sharded, double(count) / sharded / 1000., old / sharded);
+        round++;
+    }
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include "../KiwiWriter.h"
+#include <atomic>
+#include <malloc.h>
+
+using namespace Kiwi;
+
+static atomic<ulong> allocations(0ul);
+static atomic<ulong> allocated(0ul);
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1ul, memory_order_relaxed);
+    allocated.fetch_add(size, memory_order_relaxed);
+    if(void* pointer = malloc(size ? size : 1))
+    {
+        return pointer;
+    }
+    throw bad_alloc();
+}
+
+// the deletes aren't inlined, otherwise the compiler pairs their free with the operator new of the containers and warns
+__attribute__((noinline)) void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+__attribute__((noinline)) void operator delete(void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+//! The allocations and the bytes allocated since a start, and the growth of the heap, which counts the headers of the blocks and not the blocks released.
+struct Usage
+{
+    ulong allocations;
+    ulong bytes;
+    ulong used;
+    
+    static Usage now() noexcept
+    {
+        const struct mallinfo2 info = mallinfo2();
+        return Usage{::allocations.load(), ::allocated.load(), ulong(info.uordblks + info.hblkhd)};
+    }
+    
+    Usage since(Usage const& start) const noexcept
+    {
+        return Usage{allocations - start.allocations, bytes - start.bytes, used - start.used};
+    }
+};
+
+//! A copy of the tag before the arena, a shared node that owns its name and returns a copy of it.
+class HeapTag
+{
+private:
+    const string m_name;
+public:
+    inline HeapTag(string const& name) noexcept : m_name(name) {}
+    inline string getName() const noexcept {return m_name;}
+};
+
+typedef shared_ptr<const HeapTag> sHeapTag;
+
+//! A copy of the table of the tags before the arena, a map of the names locked by a mutex.
+class HeapTable
+{
+private:
+    map<string, sHeapTag>   m_tags;
+    mutex                   m_mutex;
+public:
+    sHeapTag create(string const& name)
+    {
+        lock_guard<mutex> guard(m_mutex);
+        auto it = m_tags.find(name);
+        if(it != m_tags.end())
+        {
+            return it->second;
+        }
+        else
+        {
+            sHeapTag tag = make_shared<HeapTag>(name);
+            m_tags[name] = tag;
+            return tag;
+        }
+    }
+};
+
+//! Writes the objects of a patch in json like Atom::toJson did before the arena, the names of the tags are copied to be escaped.
+static void writeHeapPatch(ostream& output, vector<pair<sHeapTag, long>> const& objects, HeapTable& table)
+{
+    const sHeapTag key = table.create("objects"), text = table.create("text"), id = table.create("id");
+    output << '{' << endl << '\t' << jsonEscape(key->getName()) << " : [";
+    for(size_t i = 0; i < objects.size(); i++)
+    {
+        output << '{' << endl;
+        output << "\t\t" << jsonEscape(id->getName()) << " : " << objects[i].second << ',' << endl;
+        output << "\t\t" << jsonEscape(text->getName()) << " : " << jsonEscape(objects[i].first->getName()) << endl;
+        output << "\t}" << (i + 1 != objects.size() ? ", " : "");
+    }
+    output << ']' << endl << '}';
+}
+
+//! Creates the names of the tags of the benchmark, longer than the small string buffer like the names of the objects of a patch.
+static vector<string> createNames(string const& prefix, const ulong count)
+{
+    vector<string> names;
+    names.reserve(count);
+    for(ulong i = 0; i < count; i++)
+    {
+        names.push_back(prefix + "/object/" + toString(long(i)) + "/outlet");
+    }
+    return names;
+}
+
+// Counts the bytes and the allocations of a tag in the arena, against a copy of the table before the arena and the tags that can be reclaimed, and the allocations of a save of the tags before and after the arena.
+int main()
+{
+    const ulong count = 100000ul;
+    
+    // the table before the arena: a map of the names and a shared node that owns a copy of the name
+    HeapTable table;
+    vector<sHeapTag> heap;
+    {
+        const vector<string> names = createNames("owned", count);
+        heap.reserve(count);
+        const Usage start = Usage::now();
+        for(auto const& name : names)
+        {
+            heap.push_back(table.create(name));
+        }
+        const Usage usage = Usage::now().since(start);
+        printf("before the arena: %.2f allocations and %.1f bytes of heap per tag with the table\n", double(usage.allocations) / double(count), double(usage.used) / double(count));
+    }
+    
+    // the tags owned by the table, the allocations include the entries of the table
+    sTag last;
+    {
+        const vector<string> names = createNames("owned", count);
+        const Tag::Stats before = Tag::getStats();
+        const Usage start = Usage::now();
+        for(auto const& name : names)
+        {
+            last = Tag::create(name);
+        }
+        const Usage usage = Usage::now().since(start);
+        const Tag::Stats after = Tag::getStats();
+        const double arena = double(after.arena - before.arena) / double(count);
+        printf("arena: %.2f allocations and %.1f bytes of heap per tag with the table, %.1f bytes per tag in the arena for %.1f bytes of name\n", double(usage.allocations) / double(count), double(usage.used) / double(count), arena, double(after.bytes - before.bytes) / double(count));
+    }
+    
+    // the tags that can be reclaimed are still allocated one by one
+    {
+        const vector<string> names = createNames("reclaimed", count);
+        vector<sTag> tags;
+        tags.reserve(count);
+        Tag::setReclaim(true);
+        const Usage start = Usage::now();
+        for(auto const& name : names)
+        {
+            tags.push_back(Tag::create(name));
+        }
+        const Usage usage = Usage::now().since(start);
+        Tag::setReclaim(false);
+        printf("reclaimed: %.2f allocations and %.1f bytes of heap per tag with the table\n", double(usage.allocations) / double(count), double(usage.used) / double(count));
+    }
+    
+    // a save of the same patch before and after the arena, the names of the tags were copied and escaped in new strings
+    {
+        vector<pair<sHeapTag, long>> before;
+        Vector objects;
+        before.reserve(count);
+        objects.reserve(count);
+        for(ulong i = 0; i < count; i++)
+        {
+            before.emplace_back(heap[i], long(i));
+            Dico object;
+            object[Tags::text]  = Atom(Tag::create("owned/object/" + toString(long(i)) + "/outlet"));
+            object[Tags::id]    = Atom(long(i));
+            objects.push_back(Atom(move(object)));
+        }
+        Dico dico;
+        dico[Tags::objects] = Atom(move(objects));
+        const Atom patch(move(dico));
+        
+        ofstream file("/dev/null");
+        Usage start = Usage::now();
+        writeHeapPatch(file, before, table);
+        const Usage heapUsage = Usage::now().since(start);
+        
+        ulong indent = 0ul;
+        start = Usage::now();
+        Atom::toJson(file, patch, indent);
+        const Usage arenaUsage = Usage::now().since(start);
+        printf("save of %lu tags: %lu allocations and %lu bytes before the arena, %lu allocations and %lu bytes after\n", count, heapUsage.allocations, heapUsage.bytes, arenaUsage.allocations, arenaUsage.bytes);
+        
+        // the writer only allocates its chunks
+        Writer writer;
+        start = Usage::now();
+        const bool opened = writer.open("/dev/null", false);
+        const bool written = opened && writer.write(patch) && writer.close();
+        const Usage usage = Usage::now().since(start);
+        printf("save of %lu tags with the writer: %lu allocations and %lu bytes, %s\n", count, usage.allocations, usage.bytes, written ? "written" : "not written");
+    }
+    kiwiBenchKeep(last);
+    return 0;
+}
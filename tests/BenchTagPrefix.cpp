@@ -0,0 +1,148 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include <random>
+
+using namespace Kiwi;
+
+// Measures the completion of the names of 100k tags with the index against a linear scan of the names, and the cost of the tags created between the queries.
+int main()
+{
+    mt19937_64 generator(20141018ull);
+    const ulong count = 100000ul, queries = 20000ul, results = 10ul;
+    const vector<string> folders = {"patcher", "object", "send", "receive", "buffer", "table", "preset", "param"};
+    
+    Tag::setIndexed(true);
+    vector<string> names;
+    vector<sTag> tags;
+    names.reserve(count);
+    tags.reserve(count);
+    for(ulong i = 0; i < count; i++)
+    {
+        names.push_back(folders[generator() % folders.size()] + "/" + toString(long(generator() % 1000000ul)) + "/" + toString(long(i)));
+        tags.push_back(Tag::create(names.back()));
+    }
+    
+    // the first query merges all the tags into the index
+    auto start = kiwiBenchNow();
+    kiwiBenchKeep(Tag::getTagsWithPrefix("patcher/", results));
+    const double build = kiwiBenchElapsed(start);
+    
+    // the prefixes are the start of existing names, from the folder only to nearly the full name, the folder keeps the built-in tags out of the results
+    vector<string> prefixes;
+    for(ulong i = 0; i < queries; i++)
+    {
+        string const& name = names[generator() % count];
+        const ulong folder = name.find('/') + 1ul;
+        prefixes.push_back(name.substr(0, folder + generator() % (name.size() - folder)));
+    }
+    ulong found = 0ul;
+    start = kiwiBenchNow();
+    for(auto const& prefix : prefixes)
+    {
+        found += Tag::getTagsWithPrefix(prefix, results).size();
+    }
+    const double indexed = kiwiBenchElapsed(start);
+    
+    // the scan keeps the first names in order like the index, they must match the tags of the index
+    ulong mismatches = 0ul;
+    start = kiwiBenchNow();
+    for(ulong i = 0; i < queries / 100ul; i++)
+    {
+        string_view const prefix = prefixes[i];
+        vector<string_view> matches;
+        for(auto const& name : names)
+        {
+            if(string_view(name).substr(0, prefix.size()) == prefix)
+            {
+                matches.push_back(name);
+            }
+        }
+        partial_sort(matches.begin(), matches.begin() + long(min(results, ulong(matches.size()))), matches.end());
+        const vector<sTag> completions = Tag::getTagsWithPrefix(prefix, results);
+        mismatches += completions.size() != min(results, ulong(matches.size()));
+        for(ulong j = 0; j < completions.size() && j < matches.size(); j++)
+        {
+            mismatches += completions[j]->getName() != matches[j];
+        }
+    }
+    const double scan = kiwiBenchElapsed(start) * 100.;
+    
+    // the tags created between the queries are sorted into the overlay of the index, the time of the creation alone is measured on other names
+    const ulong interleaved = 10000ul;
+    vector<double> created;
+    start = kiwiBenchNow();
+    for(ulong i = 0; i < interleaved; i++)
+    {
+        tags.push_back(Tag::create("alone/" + toString(long(i))));
+    }
+    kiwiBenchKeep(Tag::getTagsWithPrefix("alone/", results));
+    const double alone = kiwiBenchElapsed(start);
+    for(const ulong creates : {1ul, 10ul})
+    {
+        start = kiwiBenchNow();
+        for(ulong i = 0; i < interleaved; i++)
+        {
+            if(i % (creates < 10ul ? 1ul : 10ul) == 0ul)
+            {
+                for(ulong j = 0; j < creates; j++)
+                {
+                    names.push_back("created/" + toString(long(creates)) + "/" + toString(long(i + j)));
+                    tags.push_back(Tag::create(names.back()));
+                }
+            }
+            kiwiBenchKeep(Tag::getTagsWithPrefix(prefixes[i % queries], results));
+        }
+        created.push_back(kiwiBenchElapsed(start));
+    }
+    
+    // the results after the interleaved creations must still match the scan
+    for(ulong i = 0; i < 100ul; i++)
+    {
+        const string prefix = i % 2ul ? prefixes[i] : "created/" + toString(long(1ul + i % 10ul));
+        vector<string_view> matches;
+        for(auto const& name : names)
+        {
+            if(string_view(name).substr(0, prefix.size()) == prefix)
+            {
+                matches.push_back(name);
+            }
+        }
+        partial_sort(matches.begin(), matches.begin() + long(min(results, ulong(matches.size()))), matches.end());
+        const vector<sTag> completions = Tag::getTagsWithPrefix(prefix, results);
+        mismatches += completions.size() != min(results, ulong(matches.size()));
+        for(ulong j = 0; j < completions.size() && j < matches.size(); j++)
+        {
+            mismatches += completions[j]->getName() != matches[j];
+        }
+    }
+    
+    printf("%lu tags indexed in %.1f ms\n", count, build);
+    printf("indexed: %.2f us per query, %lu tags found\n", indexed * 1e3 / double(queries), found);
+    printf("linear scan: %.2f us per query, the index is %.0fx faster\n", scan * 1e3 / double(queries), scan / indexed);
+    printf("creation alone: %.2f us per tag\n", alone * 1e3 / double(interleaved));
+    printf("a tag created before each query: %.2f us per query and creation\n", created[0] * 1e3 / double(interleaved));
+    printf("ten tags created every ten queries: %.2f us per query and creation\n", created[1] * 1e3 / double(interleaved));
+    printf("%lu mismatches between the index and the scan\n", mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiTest.h"
+#include <random>
+
+using namespace Kiwi;
+
+// Compares the formatting of messages by toText with the stream output of the atoms.
+int main()
+{
+    mt19937_64 generator(20141018ull);
+    const vector<sTag> selectors = {Tag::create("set"), Tag::create("bang"), Tag::create("metro"), Tag::create("a tag with spaces"), Tag::create("color")};
+    const ulong count = 100000ul;
+    vector<Vector> messages(count);
+    for(auto& message : messages)
+    {
+        message.push_back(Atom(selectors[generator() % selectors.size()]));
+        const ulong size = 1ul + generator() % 8ul;
+        for(ulong i = 0; i < size; i++)
+        {
+            switch(generator() % 3ul)
+            {
+                case 0: message.push_back(Atom(long(generator() % 1000ul))); break;
+                case 1: message.push_back(Atom(double(generator() % 100000ul) / 100.)); break;
+                default: message.push_back(Atom(selectors[generator() % selectors.size()])); break;
+            }
+        }
+    }
+    
+    ulong size = 0ul;
+    auto start = kiwiBenchNow();
+    for(auto const& message : messages)
+    {
+        ostringstream stream;
+        for(ulong i = 0; i < message.size(); i++)
+        {
+            if(i)
+            {
+                stream << ' ';
+            }
+            stream << message[i];
+        }
+        size += stream.str().size();
+    }
+    const double streamed = kiwiBenchElapsed(start);
+    
+    string output;
+    start = kiwiBenchNow();
+    for(auto const& message : messages)
+    {
+        output.clear();
+        Atom::toText(message, output);
+        size += output.size();
+    }
+    const double formatted = kiwiBenchElapsed(start);
+    kiwiBenchKeep(size);
+    
+    start = kiwiBenchNow();
+    ulong mismatches = 0ul;
+    for(auto const& message : messages)
+    {
+        output.clear();
+        Atom::toText(message, output);
+        mismatches += Atom::parse(output) != message;
+    }
+    const double roundtrip = kiwiBenchElapsed(start);
+    
+    printf("%lu messages: stream %.1f ms, toText %.1f ms (%.1f M messages/s), toText and parse %.1f ms with %lu mismatches\n", count, streamed, formatted, double(count) / formatted / 1000., roundtrip, mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include <poll.h>
+#include <sys/socket.h>
+
+using namespace Kiwi;
+
+//! Retrieves the current time in nanoseconds.
+static long getNanoseconds() noexcept
+{
+    return long(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//! Waits for a socket to be readable or writable.
+static void waitSocket(Wire::Socket const& socket, const short events)
+{
+    pollfd descriptor = {socket.getDescriptor(), events, 0};
+    poll(&descriptor, 1, 100);
+}
+
+//! Retrieves a percentile of sorted latencies in microseconds.
+static double getPercentile(vector<long> const& latencies, const double percentile)
+{
+    return latencies.empty() ? 0. : double(latencies[min(latencies.size() - 1ul, ulong(percentile * double(latencies.size())))]) / 1000.;
+}
+
+// Measures the throughput and the latency of the messages sent over a local socket, streamed by a thread to another and in ping-pong.
+int main()
+{
+    const ulong count = 200000ul, pings = 20000ul;
+    const sTag selector = Tag::create("position"), unit = Tag::create("pixels");
+    int descriptors[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) != 0)
+    {
+        return 1;
+    }
+    Wire::Socket output(descriptors[0]), input(descriptors[1]);
+    
+    vector<long> latencies;
+    latencies.reserve(count);
+    auto start = kiwiBenchNow();
+    thread consumer([&input, &latencies, count]()
+    {
+        while(latencies.size() < count)
+        {
+            waitSocket(input, POLLIN);
+            input.receive([&latencies](Vector& atoms)
+            {
+                latencies.push_back(getNanoseconds() - long(atoms[1]));
+            });
+        }
+    });
+    for(ulong i = 0; i < count; i++)
+    {
+        const Vector message = {Atom(selector), Atom(getNanoseconds()), Atom(long(i % 1920ul)), Atom(double(i % 1080ul) * 0.5), Atom(unit)};
+        while(!output.send(message) && output.getDescriptor() >= 0)
+        {
+            waitSocket(output, POLLOUT);
+        }
+    }
+    while(output.hasPendingOutput() && output.flush())
+    {
+        waitSocket(output, POLLOUT);
+    }
+    consumer.join();
+    const double streamed = kiwiBenchElapsed(start);
+    sort(latencies.begin(), latencies.end());
+    printf("stream: %lu messages in %.1f ms (%.2f M messages/s), latency p50 %.1f us, p99 %.1f us, p99.9 %.1f us\n", count, streamed, double(count) / streamed / 1000., getPercentile(latencies, 0.5), getPercentile(latencies, 0.99), getPercentile(latencies, 0.999));
+    
+    latencies.clear();
+    thread echo([&input, pings]()
+    {
+        ulong received = 0ul;
+        while(received < pings)
+        {
+            waitSocket(input, POLLIN);
+            input.receive([&input, &received](Vector& atoms)
+            {
+                input.send(atoms);
+                received++;
+            });
+        }
+    });
+    start = kiwiBenchNow();
+    for(ulong i = 0; i < pings; i++)
+    {
+        const long sent = getNanoseconds();
+        output.send({Atom(selector), Atom(sent)});
+        bool received = false;
+        while(!received)
+        {
+            waitSocket(output, POLLIN);
+            output.receive([&received](Vector&){received = true;});
+        }
+        latencies.push_back(getNanoseconds() - sent);
+    }
+    echo.join();
+    const double pinged = kiwiBenchElapsed(start);
+    sort(latencies.begin(), latencies.end());
+    printf("ping-pong: %lu round trips in %.1f ms, round trip p50 %.1f us, p99 %.1f us, p99.9 %.1f us\n", pings, pinged, getPercentile(latencies, 0.5), getPercentile(latencies, 0.99), getPercentile(latencies, 0.999));
+    return 0;
+}
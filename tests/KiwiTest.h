@@ -0,0 +1,73 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#ifndef __DEF_KIWI_TEST__
+#define __DEF_KIWI_TEST__
+
+#include "../KiwiCore.h"
+#include <chrono>
+
+// ================================================================================ //
+//                                      TEST                                        //
+// ================================================================================ //
+
+//! The number of checks that failed in the test, the benchmarks include the header without checking anything.
+[[maybe_unused]] static unsigned long kiwiTestFailures = 0ul;
+
+//! Checks a condition, prints it and counts the failure if it is false.
+#define KIWI_CHECK(condition) \
+do \
+{ \
+    if(!(condition)) \
+    { \
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        kiwiTestFailures++; \
+    } \
+} while(0)
+
+//! Returns the exit code of the test.
+#define KIWI_TEST_RESULT() (kiwiTestFailures ? 1 : 0)
+
+// ================================================================================ //
+//                                      BENCHMARK                                   //
+// ================================================================================ //
+
+//! Retrieves the current time of the benchmarks.
+static inline std::chrono::steady_clock::time_point kiwiBenchNow() noexcept
+{
+    return std::chrono::steady_clock::now();
+}
+
+//! Retrieves the time elapsed since a start in milliseconds.
+static inline double kiwiBenchElapsed(std::chrono::steady_clock::time_point const& start) noexcept
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//! Prevents the compiler from removing the computation of a value.
+template<class T> static inline void kiwiBenchKeep(T const& value) noexcept
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+#endif
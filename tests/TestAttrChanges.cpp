@@ -0,0 +1,95 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include "KiwiTest.h"
+
+using namespace Kiwi;
+
+//! A manager with two saved attributes and an unsaved one.
+class ChangeManager : public Attr::Manager
+{
+public:
+    ChangeManager()
+    {
+        createAttr(Tag::create("value"), "Value", "Test", 0l);
+        createAttr(Tag::create("other"), "Other", "Test", 0l);
+        createAttr(Tag::create("transient"), "Transient", "Test", 0l, Attr::Unsaved);
+    }
+};
+
+// The manager must mark the attributes set by the edits, write only the changes since the last checkpoint and never mark the values it reads nor write the unsaved attributes.
+int main()
+{
+    const sTag value = Tag::create("value"), other = Tag::create("other"), transient = Tag::create("transient");
+    const shared_ptr<ChangeManager> manager = make_shared<ChangeManager>();
+    KIWI_CHECK(!manager->hasChanges());
+    
+    // an unsaved attribute isn't marked, a saved one is, setting the same value again doesn't mark it
+    manager->setAttrValue(transient, Atom(1l));
+    KIWI_CHECK(!manager->hasChanges());
+    manager->setAttrValue(value, Atom(0l));
+    KIWI_CHECK(!manager->hasChanges());
+    manager->setAttrValue(value, Atom(2l));
+    KIWI_CHECK(manager->hasChanges());
+    
+    // the changes only hold the attributes that changed, then the checkpoint is reset
+    Dico changes;
+    KIWI_CHECK(manager->writeChanges(changes));
+    KIWI_CHECK(changes.size() == 1ul && changes[value] == 2l);
+    KIWI_CHECK(!manager->hasChanges());
+    changes.clear();
+    KIWI_CHECK(!manager->writeChanges(changes));
+    KIWI_CHECK(changes.empty());
+    
+    // the values read aren't marked, and the edits that weren't written yet are kept
+    Dico state;
+    state[value] = Atom(3l);
+    state[other] = Atom(4l);
+    state[transient] = Atom(5l);
+    manager->read(state);
+    KIWI_CHECK(manager->getAttrValue(value) == 3l && manager->getAttrValue(other) == 4l && manager->getAttrValue(transient) == 5l);
+    KIWI_CHECK(!manager->hasChanges());
+    manager->setAttrValue(other, Atom(6l));
+    manager->read(state);
+    KIWI_CHECK(manager->getAttrValue(other) == 4l && manager->hasChanges());
+    changes.clear();
+    KIWI_CHECK(manager->writeChanges(changes));
+    KIWI_CHECK(changes.size() == 1ul && changes[other] == 4l);
+    
+    // clearChanges sets a checkpoint without writing
+    manager->setAttrValue(value, Atom(7l));
+    manager->clearChanges();
+    KIWI_CHECK(!manager->hasChanges());
+    changes.clear();
+    KIWI_CHECK(!manager->writeChanges(changes) && changes.empty());
+    
+    // the complete write skips the unsaved attributes and doesn't reset the changes
+    manager->setAttrValue(other, Atom(8l));
+    Dico saved;
+    manager->write(saved);
+    KIWI_CHECK(saved.size() == 2ul && saved[value] == 7l && saved[other] == 8l && saved.find(transient) == saved.end());
+    KIWI_CHECK(manager->hasChanges());
+    
+    printf("%lu of the 3 attributes saved\n", ulong(saved.size()));
+    return KIWI_TEST_RESULT();
+}
@@ -0,0 +1,115 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+
+using namespace Kiwi;
+
+//! A manager that records the order of its notifications.
+class OrderManager : public Attr::Manager
+{
+public:
+    const ulong         m_index;
+    vector<ulong>&      m_order;
+    
+    OrderManager(const ulong index, vector<ulong>& order) : m_index(index), m_order(order)
+    {
+        createAttr(Tag::create("value"), "Value", "Test", 0l);
+        createAttr(Tag::create("other"), "Other", "Test", 0l);
+    }
+    
+    bool notify(sAttr) override
+    {
+        m_order.push_back(m_index);
+        return true;
+    }
+};
+
+// The parallel read must decode the dicos of a manager that appears several times in the order of the vector and notify in the order of the vector.
+int main()
+{
+    const sTag value = Tag::create("value"), other = Tag::create("other");
+    const ulong count = 2000ul, repeats = 3ul;
+    vector<ulong> order;
+    vector<shared_ptr<OrderManager>> objects;
+    for(ulong i = 0; i < count; i++)
+    {
+        objects.push_back(make_shared<OrderManager>(i, order));
+    }
+    
+    vector<Dico> dicos;
+    vector<Attr::sManager> owners;
+    vector<ulong> expected;
+    for(ulong r = 0; r < repeats; r++)
+    {
+        for(ulong i = 0; i < count; i++)
+        {
+            Dico dico;
+            dico[value] = Atom(long(r + 1ul));
+            if(r == 0ul)
+            {
+                dico[other] = Atom(long(i + 1ul));
+                expected.push_back(i);
+            }
+            dicos.push_back(dico);
+            owners.push_back(objects[i]);
+            expected.push_back(i);
+        }
+        dicos.push_back(Dico());
+        owners.push_back(nullptr);
+    }
+    vector<pair<Attr::sManager, Dico const*>> managers;
+    for(ulong i = 0; i < dicos.size(); i++)
+    {
+        managers.emplace_back(owners[i], &dicos[i]);
+    }
+    
+    Attr::Manager::read(managers, 4ul);
+    KIWI_CHECK(order == expected);
+    for(ulong i = 0; i < count; i++)
+    {
+        KIWI_CHECK(objects[i]->getAttrValue(value) == long(repeats));
+        KIWI_CHECK(objects[i]->getAttrValue(other) == long(i + 1ul));
+    }
+    
+    // the dicos are decoded again one after the other, so only the values change
+    order.clear();
+    Attr::Manager::read(managers, 4ul);
+    KIWI_CHECK(order.size() == count * repeats);
+    
+    // the small reads are read one after the other on the calling thread, the second dico of a manager holds the same values so only the first one changes them
+    const ulong few = count / 10ul;
+    vector<pair<Attr::sManager, Dico const*>> small(managers.begin(), managers.begin() + long(few));
+    small.insert(small.end(), managers.begin(), managers.begin() + long(few));
+    order.clear();
+    Attr::Manager::read(small, 4ul);
+    vector<ulong> firsts;
+    for(ulong i = 0; i < few; i++)
+    {
+        firsts.push_back(i);
+        KIWI_CHECK(objects[i]->getAttrValue(value) == 1l);
+    }
+    KIWI_CHECK(order == firsts);
+    
+    printf("%lu managers read %lu times\n", count, repeats);
+    return KIWI_TEST_RESULT();
+}
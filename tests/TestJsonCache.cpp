@@ -0,0 +1,135 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include <random>
+
+using namespace Kiwi;
+
+//! Creates a random tree of atoms with few different values so that the subtrees repeat.
+static Atom createTree(mt19937_64& generator, const ulong depth)
+{
+    static const vector<sTag> names = {Tag::create("name"), Tag::create("value"), Tag::create("text"), Tag::create("id")};
+    switch(depth ? generator() % 6ul : generator() % 4ul)
+    {
+        case 0: return Atom(bool(generator() % 2ul));
+        case 1: return Atom(long(generator() % 3ul));
+        case 2: return Atom(double(generator() % 3ul) * (generator() % 2ul ? 1. : -1.));
+        case 3: return Atom(names[generator() % names.size()]);
+        case 4:
+        {
+            Vector vector;
+            for(ulong i = generator() % 4ul; i; i--)
+            {
+                vector.push_back(createTree(generator, depth - 1ul));
+            }
+            return Atom(vector);
+        }
+        default:
+        {
+            Dico dico;
+            for(ulong i = generator() % 4ul; i; i--)
+            {
+                dico[names[generator() % names.size()]] = createTree(generator, depth - 1ul);
+            }
+            return Atom(dico);
+        }
+    }
+}
+
+//! Writes an atom in json with or without a cache.
+static string writeJson(Atom const& atom, Atom::Cache* cache, const bool boolalpha)
+{
+    ostringstream stream;
+    if(boolalpha)
+    {
+        stream << std::boolalpha;
+    }
+    ulong indent = 0ul;
+    if(cache)
+    {
+        Atom::toJson(stream, atom, indent, *cache);
+    }
+    else
+    {
+        Atom::toJson(stream, atom, indent);
+    }
+    return stream.str();
+}
+
+// The json text written with a cache must be the text written without it, whatever the passes, the flags of the stream and the collisions of the content hashes.
+int main()
+{
+    mt19937_64 generator(20141018ull);
+    Atom::Cache cache, small(64ul);
+    const ulong passes = 200ul;
+    ulong mismatches = 0ul;
+    for(ulong pass = 0; pass < passes; pass++)
+    {
+        const bool boolalpha = pass % 3ul == 0ul;
+        Vector trees;
+        for(ulong i = 0; i < 20ul; i++)
+        {
+            trees.push_back(createTree(generator, 4ul));
+        }
+        const Atom atom(trees);
+        // the small cache drops the text of the subtrees that become too large while they are written
+        const string expected = writeJson(atom, nullptr, boolalpha);
+        mismatches += writeJson(atom, &cache, boolalpha) != expected;
+        mismatches += writeJson(atom, &small, boolalpha) != expected;
+        mismatches += writeJson(atom, &small, boolalpha) != expected;
+        cache.purge();
+        small.purge();
+    }
+    KIWI_CHECK(mismatches == 0ul);
+    KIWI_CHECK(small.size() && small.getNumberOfBytes() <= small.size() * 64ul);
+    
+    // the same vectors written with different flags or with numbers of other types
+    KIWI_CHECK(writeJson(Atom(Vector{Atom(true)}), &cache, true) == "[true]");
+    KIWI_CHECK(writeJson(Atom(Vector{Atom(true)}), &cache, false) == "[1]");
+    KIWI_CHECK(writeJson(Atom(Vector{Atom(0.)}), &cache, false) == "[0.0]");
+    KIWI_CHECK(writeJson(Atom(Vector{Atom(-0.)}), &cache, false) == "[-0.0]");
+    
+    // every subtree has the same content hash, the second hash keeps the text of one from being written for another
+    Atom::Cache colliding(1048576ul, [](Atom const&){return uint64_t(42);});
+    Vector first, second;
+    for(long i = 0; i < 16l; i++)
+    {
+        first.push_back(Atom(i));
+        second.push_back(Atom(i + 1l));
+    }
+    KIWI_CHECK(writeJson(Atom(first), &colliding, false) == writeJson(Atom(first), nullptr, false));
+    KIWI_CHECK(writeJson(Atom(second), &colliding, false) == writeJson(Atom(second), nullptr, false));
+    KIWI_CHECK(writeJson(Atom(first), &colliding, false) == writeJson(Atom(first), nullptr, false));
+    ulong collisions = 0ul;
+    for(ulong pass = 0; pass < 20ul; pass++)
+    {
+        const Atom atom = createTree(generator, 4ul);
+        collisions += writeJson(atom, &colliding, false) != writeJson(atom, nullptr, false);
+        collisions += writeJson(atom, &colliding, false) != writeJson(atom, nullptr, false);
+        colliding.purge();
+    }
+    KIWI_CHECK(collisions == 0ul);
+    
+    printf("%lu passes, %lu mismatches, %lu entries\n", passes, mismatches, cache.size());
+    return KIWI_TEST_RESULT();
+}
@@ -0,0 +1,183 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include "../KiwiLoader.h"
+#include <unistd.h>
+
+using namespace Kiwi;
+
+//! Writes a text to a file.
+static void writeText(string const& path, string const& text)
+{
+    ofstream file(path, ios::out | ios::binary | ios::trunc);
+    file.write(text.data(), streamsize(text.size()));
+}
+
+//! Loads a file and retrieves the sections in the order of the callback with the progress seen by each one.
+static bool loadFile(string const& path, const ulong chunksize, vector<pair<sTag, Atom>>& sections, Dico& dico, vector<double>& progress)
+{
+    Loader loader(chunksize);
+    sections.clear();
+    progress.clear();
+    future<Dico> result = loader.load(path, [&sections, &progress, &loader](sTag name, Atom& value)
+    {
+        sections.push_back({name, value});
+        progress.push_back(loader.getProgress());
+    });
+    try
+    {
+        dico = result.get();
+    }
+    catch(Error const&)
+    {
+        return false;
+    }
+    return loader.getBytesRead() == loader.getSize() && loader.getProgress() == 1. && loader.getNumberOfSections() == sections.size();
+}
+
+// The loader must decode the sections of a file whatever the chunks that split them, deliver them in the order of the file, report the invalid files through the future and stop when it is cancelled.
+int main()
+{
+    const string path = "/tmp/kiwi-test-loader-" + toString(long(getpid())) + ".json";
+    
+    // the strings hold the characters that delimit the sections and the escape sequences, so the chunks of one or three bytes cut them everywhere
+    const string text =
+    "  {\n"
+    "\t\"name\" : \"a patch, with {braces} and [brackets]\",\n"
+    "\t\"a \\\"quoted\\\" key\" : 1,\n"
+    "\t\"a \\\\ back\\/slash\\n key\" : [1, 2.5, \"three\", {\"four\" : \"}\"}],\n"
+    "\t\"objects\" : [{\"id\" : 1, \"text\" : \"\\\"metro\\\" 100\"}, {\"id\" : 2, \"text\" : \"print ,\"}],\n"
+    "\t\"links\" : [],\n"
+    "\t\"empty\" : {},\n"
+    "\t\"last\" : -0.25e2\n"
+    "}\n  ";
+    writeText(path, text);
+    const Atom expected = Atom::fromJson(text);
+    const vector<string> names = {"name", "a \"quoted\" key", "a \\ back/slash\n key", "objects", "links", "empty", "last"};
+    
+    for(const ulong chunksize : {1ul, 3ul, 7ul, 65536ul})
+    {
+        vector<pair<sTag, Atom>> sections;
+        vector<double> progress;
+        Dico dico;
+        KIWI_CHECK(loadFile(path, chunksize, sections, dico, progress));
+        KIWI_CHECK(Atom(dico) == expected);
+        KIWI_CHECK(sections.size() == names.size());
+        for(ulong i = 0; i < sections.size() && i < names.size(); i++)
+        {
+            KIWI_CHECK(sections[i].first->getName() == names[i]);
+            KIWI_CHECK(sections[i].second == dico[sections[i].first]);
+        }
+        // the sections are sent while the rest of the file is being read
+        KIWI_CHECK(is_sorted(progress.begin(), progress.end()));
+        KIWI_CHECK(!progress.empty() && progress.front() > 0. && (chunksize > text.size() || progress.front() < 1.));
+    }
+    
+    // the invalid files reach the future with an error, the sections before the error are sent, a bracket closed by the other one is an error
+    const vector<pair<string, ulong>> invalids =
+    {
+        {"[1, 2]", 0ul},
+        {"{\"a\" : 1, 2 : 3}", 1ul},
+        {"{\"a\" : 1, \"b\" 2}", 1ul},
+        {"{\"a\" : 1, \"b\" : [1, 2}", 1ul},
+        {"{\"a\" : 1, \"b\" : tru}", 1ul},
+        {"{\"a\" : 1, \"b\" : \"open", 1ul},
+        {"{\"a\" : 1} }", 1ul},
+        {"{\"a\" : 1}, {}", 1ul},
+        {"{\"a\" : 1]", 0ul},
+        {"{\"a\" : [1, 2}, \"b\" : 3}", 0ul},
+        {"{\"a\" : 1, \"b\" : {\"c\" : [1}], \"d\" : 2}", 1ul},
+        {"", 0ul}
+    };
+    for(auto const& invalid : invalids)
+    {
+        writeText(path, invalid.first);
+        for(const ulong chunksize : {1ul, 3ul, 65536ul})
+        {
+            vector<pair<sTag, Atom>> sections;
+            vector<double> progress;
+            Dico dico;
+            KIWI_CHECK(!loadFile(path, chunksize, sections, dico, progress));
+            KIWI_CHECK(sections.size() == invalid.second);
+        }
+    }
+    {
+        Loader loader;
+        bool failed = false;
+        try
+        {
+            loader.load(path + ".missing").get();
+        }
+        catch(Error const&)
+        {
+            failed = true;
+        }
+        KIWI_CHECK(failed);
+    }
+    
+    // a large patch cancelled from its callback stops before the next section
+    const ulong count = 10000ul, stop = 100ul;
+    string large = "{";
+    for(ulong i = 0; i < count; i++)
+    {
+        large += (i ? ",\n\"object " : "\n\"object ") + toString(long(i)) + "\" : {\"id\" : " + toString(long(i)) + ", \"text\" : \"metro " + toString(long(i)) + "\"}";
+    }
+    large += "\n}\n";
+    writeText(path, large);
+    {
+        Loader loader(3ul);
+        ulong received = 0ul;
+        future<Dico> result = loader.load(path, [&received, &loader](sTag, Atom&)
+        {
+            if(++received == stop)
+            {
+                loader.cancel();
+            }
+        });
+        bool cancelled = false;
+        try
+        {
+            result.get();
+        }
+        catch(Error const&)
+        {
+            cancelled = true;
+        }
+        KIWI_CHECK(cancelled);
+        KIWI_CHECK(received == stop && loader.getNumberOfSections() == stop);
+        KIWI_CHECK(loader.getProgress() > 0. && loader.getProgress() < 1.);
+        
+        // the loader can load again after a cancellation
+        Dico dico = loader.load(path).get();
+        KIWI_CHECK(dico.size() == count && loader.getNumberOfSections() == count && loader.getProgress() == 1.);
+    }
+    {
+        // the destructor cancels the loading and waits for the thread
+        Loader loader(1ul);
+        loader.load(path);
+    }
+    
+    unlink(path.c_str());
+    printf("%lu sections, %lu invalid files, cancelled after %lu of %lu sections\n", names.size(), invalids.size(), stop, count);
+    return KIWI_TEST_RESULT();
+}
@@ -0,0 +1,86 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiTest.h"
+
+using namespace Kiwi;
+
+// The streaming parser must give the messages of parseLines whatever the chunks and discard the messages that are too large.
+int main()
+{
+    vector<Vector> messages;
+    Atom::Parser parser([&messages](Vector& atoms) {messages.push_back(move(atoms));}, 4096ul);
+    
+    // the chunks split the words, the quotes and the carriage returns
+    const string text = "set 1 2.5 \"a quoted\\\" tag\"\r\nbang\n\"unclosed quote\nlast -3";
+    for(ulong size = 1ul; size < text.size(); size++)
+    {
+        messages.clear();
+        parser.clear();
+        for(ulong pos = 0ul; pos < text.size(); pos += size)
+        {
+            parser.write(text.data() + pos, min(size, text.size() - pos));
+        }
+        parser.flush();
+        KIWI_CHECK(messages == Atom::parseLines(text));
+    }
+    
+    // a stream without new lines can't grow the parser beyond its limit
+    messages.clear();
+    parser.clear();
+    parser.write("before\n");
+    const string chunk(1000ul, 'x');
+    ulong errors = 0ul;
+    for(ulong i = 0ul; i < 10000ul; i++)
+    {
+        try
+        {
+            parser.write(chunk);
+        }
+        catch(Error const&)
+        {
+            errors++;
+        }
+    }
+    parser.write(" still the same message\nafter 1\n");
+    KIWI_CHECK(errors == 1ul);
+    KIWI_CHECK(messages.size() == 2ul);
+    KIWI_CHECK(messages.size() == 2ul && messages[0] == Vector{Atom(Tag::create("before"))});
+    KIWI_CHECK(messages.size() == 2ul && messages[1] == Vector({Atom(Tag::create("after")), Atom(1l)}));
+    
+    // the messages completed in the chunk that overflows are delivered
+    messages.clear();
+    bool thrown = false;
+    try
+    {
+        parser.write("first\n" + string(5000ul, 'y') + "\nsecond\n");
+    }
+    catch(Error const&)
+    {
+        thrown = true;
+    }
+    KIWI_CHECK(thrown && messages.size() == 2ul);
+    
+    printf("%lu chunk sizes, %lu error for %lu bytes without new line\n", ulong(text.size() - 1ul), errors, ulong(chunk.size() * 10000ul));
+    return KIWI_TEST_RESULT();
+}
@@ -0,0 +1,110 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace Kiwi;
+
+//! Creates the message of an index, with tags created after the fork so that each process has its own.
+static Vector createMessage(const ulong index)
+{
+    Vector numbers;
+    for(ulong i = 0; i < index % 50ul; i++)
+    {
+        numbers.push_back(Atom(long(index * i)));
+    }
+    return {Atom(long(index)), Atom(Tag::create("ring/tag/" + toString(long(index % 97ul)))), Atom(double(index) / 4.), Atom(move(numbers))};
+}
+
+//! Receives the messages in the child process and checks them.
+static int receiveMessages(string const& name, const ulong count)
+{
+    Wire::Ring ring;
+    if(!ring.open(name))
+    {
+        return 2;
+    }
+    ulong received = 0ul, errors = 0ul;
+    const auto start = kiwiBenchNow();
+    while(received < count && kiwiBenchElapsed(start) < 60000.)
+    {
+        if(ring.wait(100ul) && !ring.receive([&received, &errors](Vector& atoms)
+        {
+            errors += atoms != createMessage(received++);
+        }))
+        {
+            return 3;
+        }
+    }
+    return (received == count && !errors) ? 0 : 1;
+}
+
+// The frames sent through a small ring by a process must be received intact by another one, while the ring wraps around and fills up.
+int main()
+{
+    const string name = "/kiwi-test-ring-" + toString(long(getpid()));
+    const ulong count = 100000ul;
+    Wire::Ring ring;
+    KIWI_CHECK(ring.create(name, 4096ul));
+    
+    const pid_t child = fork();
+    if(child == 0)
+    {
+        _exit(receiveMessages(name, count));
+    }
+    KIWI_CHECK(child > 0);
+    
+    ulong full = 0ul;
+    bool alive = true;
+    for(ulong i = 0; i < count && alive; i++)
+    {
+        const Vector message = createMessage(i);
+        while(!ring.send(message))
+        {
+            full++;
+            this_thread::yield();
+            if(waitpid(child, nullptr, WNOHANG) == child)
+            {
+                alive = false;
+                break;
+            }
+        }
+    }
+    KIWI_CHECK(alive);
+    
+    int status = -1;
+    if(alive)
+    {
+        waitpid(child, &status, 0);
+    }
+    KIWI_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    ring.close();
+    
+    // the ring has been removed with its creator
+    Wire::Ring closed;
+    KIWI_CHECK(!closed.open(name));
+    
+    printf("%lu messages received by the other process, the ring was full %lu times\n", count, full);
+    return KIWI_TEST_RESULT();
+}
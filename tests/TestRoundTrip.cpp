@@ -0,0 +1,92 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiTest.h"
+#include <random>
+
+using namespace Kiwi;
+
+// The doubles formatted by toString, toText and toJson must read back to the same values.
+int main()
+{
+    mt19937_64 generator(20141018ull);
+    uniform_int_distribution<int> exponents(-30, 30);
+    const ulong count = 200000ul;
+    ulong checked = 0ul;
+    for(ulong i = 0; i < count; i++)
+    {
+        // half of the values have random bits, the other half have a few decimals like the values of the users
+        double value;
+        if(i & 1ul)
+        {
+            const uint64_t bits = generator();
+            memcpy(&value, &bits, sizeof(value));
+            if(!isfinite(value))
+            {
+                continue;
+            }
+        }
+        else
+        {
+            value = double(long(generator() % 2000001ull) - 1000000l) * pow(10., exponents(generator));
+        }
+        
+        const string text = toString(value);
+        const double parsed = strtod(text.c_str(), nullptr);
+        KIWI_CHECK(memcmp(&parsed, &value, sizeof(value)) == 0);
+        
+        const Vector words = Atom::parse(text);
+        KIWI_CHECK(words.size() == 1 && words[0].isDouble() && double(words[0]) == value);
+        
+        const Vector atoms = Atom::parse(Atom::toText(Vector{Atom(value)}));
+        KIWI_CHECK(atoms.size() == 1 && atoms[0].isDouble() && double(atoms[0]) == value);
+        
+        ostringstream json;
+        ulong indent = 0ul;
+        Atom::toJson(json, Atom(value), indent);
+        const Atom atom = Atom::fromJson(json.str());
+        KIWI_CHECK(atom.isDouble() && double(atom) == value);
+        
+        const float single = float(value);
+        if(isfinite(single))
+        {
+            const string stext = toString(single);
+            KIWI_CHECK(strtof(stext.c_str(), nullptr) == single);
+        }
+        checked++;
+    }
+    
+    KIWI_CHECK(toString(1.) == "1.");
+    KIWI_CHECK(toString(0.1) == "0.1");
+    KIWI_CHECK(toString(-2.5) == "-2.5");
+    KIWI_CHECK(toString(1e-7) == "0.0000001");
+    KIWI_CHECK(toString(1e16) == "10000000000000000.");
+    for(const double value : {1e-7, 1e16, -3e-300, 1.7976931348623157e308, 4.9e-324})
+    {
+        const Vector words = Atom::parse(toString(value));
+        KIWI_CHECK(words.size() == 1 && words[0].isDouble() && double(words[0]) == value);
+    }
+    
+    printf("round trip of %lu doubles\n", checked);
+    return KIWI_TEST_RESULT();
+}
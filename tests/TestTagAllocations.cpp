@@ -0,0 +1,106 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiTest.h"
+#include <atomic>
+
+using namespace Kiwi;
+
+static atomic<ulong> allocations(0ul);
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1ul, memory_order_relaxed);
+    if(void* pointer = malloc(size ? size : 1))
+    {
+        return pointer;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+// Retrieving tags that already exist and creating the built-in tags must never allocate memory, whatever the type of the name.
+int main()
+{
+    // the first lookup of a built-in tag creates the shared pointers of the built-in tags in static storage
+    ulong start = allocations.load();
+    const sTag name = Tags::name;
+    KIWI_CHECK(name == Tags::name && Tag::fromId(name->getId()) == name && Tag::create("set") == Tags::set);
+    KIWI_CHECK(allocations.load() == start);
+    
+    // more names than the thread cache holds, longer than the small string buffer
+    const ulong count = 1024ul;
+    vector<string> names;
+    vector<sTag> tags;
+    // the first number is as long as the names, so the buffer of the words grows the same way in both texts
+    string words, numbers = string(40, '0') + "1 ";
+    for(ulong i = 0; i < count; i++)
+    {
+        names.push_back("an_existing_tag_with_a_long_name_" + toString(long(i)));
+        tags.push_back(Tag::create(names.back()));
+        words += names.back() + " ";
+        numbers += toString(long(i)) + " ";
+    }
+    words += "\"an escaped\\\"name\"";
+    const sTag escaped = Tag::create("an escaped\"name");
+    Atom::parse(words);
+    Atom::parse(numbers);
+    
+    ulong failures = 0ul;
+    const ulong before = allocations.load();
+    for(ulong i = 0; i < count; i++)
+    {
+        string const& name = names[i];
+        failures += Tag::create(name) != tags[i];
+        failures += Tag::create(string_view(name)) != tags[i];
+        failures += Tag::create(name.c_str()) != tags[i];
+        failures += Tag::create(name.data(), name.size()) != tags[i];
+        failures += &Tag::get(name) != tags[i].get();
+    }
+    failures += Tag::create("name") != Tags::name;
+    KIWI_CHECK(failures == 0ul);
+    KIWI_CHECK(allocations.load() == before);
+    
+    // the atoms are allocated but the lookups of their tags aren't
+    start = allocations.load();
+    const Vector atoms = Atom::parse(words);
+    const ulong tagged = allocations.load() - start;
+    start = allocations.load();
+    const Vector longs = Atom::parse(numbers);
+    const ulong numbered = allocations.load() - start;
+    KIWI_CHECK(atoms.size() == count + 1 && longs.size() == count + 1);
+    KIWI_CHECK(atoms.back() == escaped && atoms.front() == names.front());
+    KIWI_CHECK(tagged == numbered);
+    
+    printf("%lu hits, %lu allocations to parse %lu tags and %lu to parse %lu longs\n", count * 5ul + 1ul, tagged, atoms.size(), numbered, longs.size());
+    return KIWI_TEST_RESULT();
+}
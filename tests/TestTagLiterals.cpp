@@ -0,0 +1,81 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+
+using namespace Kiwi;
+
+//! Retrieves the name of the tag of an atom.
+static string_view getName(Atom const& atom)
+{
+    return atom.isTag() ? sTag(atom)->getName() : string_view();
+}
+
+// The members of Tags and the tag literals must be usable in every place where a tag was, atoms, vectors, dicos and comparisons.
+int main()
+{
+    static_assert(Tags::name == Tags::name && Tags::name != Tags::text, "The literals are compared at compile time");
+    static_assert("set"_tag == Tags::set, "A literal is the same as the member of Tags with its name");
+    KIWI_CHECK(Tags::name == Tags::name && !(Tags::name == Tags::text));
+    KIWI_CHECK(Tags::name != Tags::text && !(Tags::set != Tags::set));
+    KIWI_CHECK(Tags::Font != Tags::font && Tags::_empty == ""_tag);
+    
+    Atom atom = Tags::set;
+    KIWI_CHECK(atom.isTag() && atom == Tags::set && atom != Tags::bang && getName(atom) == "set");
+    atom = Tags::bang;
+    KIWI_CHECK(atom == Tags::bang && atom == Tag::create("bang"));
+    atom = "a literal of the test"_tag;
+    KIWI_CHECK(atom == Tag::create("a literal of the test"));
+    
+    const Vector vector{Tags::set, Atom(1l), Tags::position};
+    KIWI_CHECK(vector.size() == 3ul && vector[0] == Tags::set && vector[1] == 1l && vector[2] == Tags::position);
+    Vector pushed;
+    pushed.push_back(Tags::size);
+    pushed.emplace_back(Tags::color);
+    KIWI_CHECK(pushed == Vector({Atom(Tag::create("size")), Atom(Tag::create("color"))}));
+    KIWI_CHECK(getName(Tags::text) == "text");
+    
+    Dico dico;
+    dico[Tags::name] = Tags::text;
+    dico[Tags::id] = Atom(Tags::object);
+    KIWI_CHECK(dico[Tag::create("name")] == Tags::text && dico.at(Tags::id) == Tags::object);
+    
+    const sTag tag = Tags::link;
+    KIWI_CHECK(tag == Tags::link && Tags::link == tag && tag != Tags::links && Tags::link->getName() == "link");
+    KIWI_CHECK(tag == Tag::create(Tags::link) && tag.get() == &Tag::get("link"));
+    
+    // the retrievals of the built-in tags aren't counted, the ones of the other tags are
+    const Tag::Stats before = Tag::getStats();
+    for(ulong i = 0; i < 100ul; i++)
+    {
+        kiwiBenchKeep(Tag::create(Tags::name));
+        kiwiBenchKeep(Tag::create("name"));
+        kiwiBenchKeep(Tag::get("set"));
+    }
+    KIWI_CHECK(Tag::getStats().hits == before.hits);
+    kiwiBenchKeep(Tag::create("a literal of the test"_tag));
+    kiwiBenchKeep(Tag::create("a literal of the test"));
+    KIWI_CHECK(Tag::getStats().hits == before.hits + 2ul);
+    
+    printf("%lu tags compared\n", ulong(vector.size() + pushed.size() + dico.size()));
+    return KIWI_TEST_RESULT();
+}
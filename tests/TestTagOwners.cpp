@@ -0,0 +1,68 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+
+using namespace Kiwi;
+
+// The tags must have their own control blocks, so their weak pointers don't expire while they live and owner_less tells them apart.
+int main()
+{
+    Tag::setIndexed(true);
+    const sTag builtin = Tag::create("name"), other = Tags::position;
+    const sTag owned = Tag::create("an owned tag"), second = Tag::create("an other owned tag");
+    Tag::setReclaim(true);
+    sTag reclaimed = Tag::create("a reclaimed tag");
+    Tag::setReclaim(false);
+    
+    for(auto const& tag : {builtin, other, owned, second, reclaimed})
+    {
+        const wTag weak = Tag::create(tag->getName());
+        KIWI_CHECK(!weak.expired() && weak.lock() == tag);
+        KIWI_CHECK(Tag::fromId(tag->getId()) == tag);
+        KIWI_CHECK(!owner_less<sTag>()(tag, Tag::create(tag->getName())) && !owner_less<sTag>()(Tag::create(tag->getName()), tag));
+    }
+    
+    // the tags are different keys of a set ordered by their owners
+    set<wTag, owner_less<wTag>> owners = {builtin, other, owned, second, reclaimed, Tag::create("name"), Tag::create("an owned tag")};
+    KIWI_CHECK(owners.size() == 5ul);
+    
+    // the tags retrieved by prefix are the tags of the table
+    const vector<sTag> prefixed = Tag::getTagsWithPrefix("an ", 10ul);
+    KIWI_CHECK(prefixed.size() == 2ul && prefixed[0] == second && prefixed[1] == owned);
+    KIWI_CHECK(!wTag(prefixed[0]).expired() && !owner_less<sTag>()(prefixed[1], owned) && !owner_less<sTag>()(owned, prefixed[1]));
+    
+    // the tag of a literal can be accessed like a tag
+    KIWI_CHECK(Tags::name->getName() == "name" && Tags::name->getId() == builtin->getId());
+    
+    // a tag that can be reclaimed still expires
+    const wTag weak = reclaimed;
+    reclaimed.reset();
+    for(ulong i = 0; i < 1024ul; i++)
+    {
+        Tag::create("evicts the cache " + toString(long(i)));
+    }
+    KIWI_CHECK(weak.expired());
+    
+    printf("%lu tags with distinct owners\n", owners.size());
+    return KIWI_TEST_RESULT();
+}
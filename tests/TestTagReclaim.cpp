@@ -0,0 +1,90 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiTest.h"
+#include <cstdio>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+using namespace Kiwi;
+
+#ifdef __linux__
+//! Retrieves the resident memory of the process in kilobytes.
+static long getResidentMemory()
+{
+    long size = 0l, resident = 0l;
+    if(FILE* file = fopen("/proc/self/statm", "r"))
+    {
+        if(fscanf(file, "%ld %ld", &size, &resident) != 2)
+        {
+            resident = 0l;
+        }
+        fclose(file);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024l);
+}
+#endif
+
+// The table must follow the tags in use when a stream of unique names is interned in reclaim mode.
+int main()
+{
+    Tag::setReclaim(true);
+    const Tag::Stats initial = Tag::getStats();
+    const ulong count = 2000000ul, warmup = 200000ul;
+    ulong maxTags = 0ul, maxIds = 0ul;
+#ifdef __linux__
+    long memory = 0l;
+#endif
+    for(ulong i = 0; i < count; i++)
+    {
+        const sTag tag = Tag::create("a/generated/path/to/the/unique/file/number/" + toString(long(i)));
+        KIWI_CHECK(tag->getName().size() > 40ul);
+        if(i == warmup)
+        {
+#ifdef __linux__
+            memory = getResidentMemory();
+#endif
+        }
+        else if(i > warmup && i % 1000ul == 0ul)
+        {
+            maxTags = max(maxTags, Tag::getStats().tags - initial.tags);
+            maxIds  = max(maxIds, Tag::getNumberOfIds());
+        }
+    }
+    
+    // only the tags kept by the cache of the thread can stay alive
+    const Tag::Census census = Tag::getCensus();
+    KIWI_CHECK(maxTags <= 1024ul);
+    KIWI_CHECK(maxIds <= initial.tags + 1024ul);
+    KIWI_CHECK(census.weak + census.expired <= 1024ul);
+#ifdef __linux__
+    const long growth = getResidentMemory() - memory;
+    KIWI_CHECK(growth < 4096l);
+    printf("%lu unique tags, at most %lu alive and %lu ids, %ld KB of growth\n", count, maxTags, maxIds, growth);
+#else
+    printf("%lu unique tags, at most %lu alive and %lu ids\n", count, maxTags, maxIds);
+#endif
+    Tag::setReclaim(false);
+    return KIWI_TEST_RESULT();
+}
@@ -0,0 +1,89 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include <cstdio>
+#include <unistd.h>
+
+using namespace Kiwi;
+
+//! Writes a snapshot of the tags with records of ids and names.
+static string writeSnapshot(string const& path, vector<pair<ulong, string>> const& records)
+{
+    string text = "KTAG";
+    writeVarint(records.size(), text);
+    for(auto const& record : records)
+    {
+        writeVarint(record.first, text);
+        writeVarint(record.second.size(), text);
+        text += record.second;
+    }
+    ofstream file(path, ios::binary);
+    file << text;
+    return path;
+}
+
+//! Loads a snapshot and retrieves if it has been rejected.
+static bool isRejected(string const& path)
+{
+    try
+    {
+        Tag::load(path);
+    }
+    catch(Error const&)
+    {
+        return true;
+    }
+    return false;
+}
+
+// A snapshot must give its tags their ids, and a snapshot that would break the table must be rejected without creating any tag.
+int main()
+{
+    const string prefix = "/tmp/kiwi-test-snapshot-" + toString(long(getpid()));
+    const ulong first = Tag::getNumberOfIds() + 10ul;
+    const ulong ids = Tag::getNumberOfIds();
+    
+    // a name twice under two ids
+    KIWI_CHECK(isRejected(writeSnapshot(prefix + "-dup", {{first, "snapshot/dup"}, {first + 1ul, "snapshot/dup"}})));
+    // a built-in name, ids out of order and a missing file
+    KIWI_CHECK(isRejected(writeSnapshot(prefix + "-builtin", {{first, "name"}})));
+    KIWI_CHECK(isRejected(writeSnapshot(prefix + "-order", {{first + 1ul, "snapshot/b"}, {first, "snapshot/a"}})));
+    KIWI_CHECK(isRejected(prefix + "-missing"));
+    KIWI_CHECK(Tag::getNumberOfIds() == ids);
+    
+    // a valid snapshot, the duplicated name now gets a single tag
+    KIWI_CHECK(Tag::load(writeSnapshot(prefix + "-valid", {{first, "snapshot/dup"}, {first + 1ul, "snapshot/other"}})) == 2ul);
+    const sTag dup = Tag::create("snapshot/dup");
+    KIWI_CHECK(dup->getId() == first && Tag::fromId(uint32_t(first)) == dup);
+    KIWI_CHECK(Tag::fromId(uint32_t(first + 1ul)) == Tag::create("snapshot/other"));
+    
+    // the tags skipped by the snapshot get the free ids
+    KIWI_CHECK(Tag::create("snapshot/new")->getId() < first);
+    
+    for(auto const* suffix : {"-dup", "-builtin", "-order", "-valid"})
+    {
+        remove((prefix + suffix).c_str());
+    }
+    printf("%lu ids after the snapshot\n", Tag::getNumberOfIds());
+    return KIWI_TEST_RESULT();
+}
@@ -0,0 +1,229 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+#include "KiwiTest.h"
+#include <atomic>
+#include <random>
+#include <sys/socket.h>
+
+using namespace Kiwi;
+
+static atomic<ulong> allocations(0ul);
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1ul, memory_order_relaxed);
+    if(void* pointer = malloc(size ? size : 1))
+    {
+        return pointer;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+//! Appends a variable-length integer to a frame.
+static void appendVarint(uint64_t value, string& frame)
+{
+    while(value >= 0x80)
+    {
+        frame += char((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    frame += char(value);
+}
+
+//! Creates a random atom.
+static Atom createAtom(mt19937_64& generator, vector<sTag> const& tags, const ulong depth)
+{
+    switch(generator() % (depth ? 8ul : 6ul))
+    {
+        case 0: return Atom();
+        case 1: return Atom(bool(generator() % 2ul));
+        case 2: return Atom(long(generator()));
+        case 3: return Atom(double(long(generator() % 2000001ul) - 1000000l) / 64.);
+        case 4:
+        case 5: return Atom(tags[generator() % tags.size()]);
+        case 6:
+        {
+            Vector atoms;
+            for(ulong i = generator() % 5ul; i; i--)
+            {
+                atoms.push_back(createAtom(generator, tags, depth - 1ul));
+            }
+            return Atom(move(atoms));
+        }
+        default:
+        {
+            Dico dico;
+            for(ulong i = generator() % 5ul; i; i--)
+            {
+                dico[tags[generator() % tags.size()]] = createAtom(generator, tags, depth - 1ul);
+            }
+            return Atom(move(dico));
+        }
+    }
+}
+
+//! Decodes the frames of a buffer.
+static bool decodeFrames(Wire::Decoder& decoder, string const& buffer, vector<Vector>& messages)
+{
+    ulong position = 0ul;
+    while(position < buffer.size())
+    {
+        const ulong size = Wire::Decoder::frameSize(buffer.data() + position);
+        Vector atoms;
+        if(size > buffer.size() - position - 4ul || !decoder.decode(buffer.data() + position + 4ul, size, atoms))
+        {
+            return false;
+        }
+        messages.push_back(move(atoms));
+        position += 4ul + size;
+    }
+    return true;
+}
+
+// The decoder must rebuild the messages of the encoder, even when the dictionary is full, and refuse the frames that break the rules of the session.
+int main()
+{
+    mt19937_64 generator(20141018ull);
+    
+    // random messages with more tags than the dictionary can hold
+    vector<sTag> tags;
+    for(ulong i = 0; i < Wire::maxTags + 4096ul; i++)
+    {
+        tags.push_back(Tag::create("wire/tag/" + toString(long(i))));
+    }
+    Wire::Encoder encoder;
+    Wire::Decoder decoder;
+    vector<Vector> messages, decoded;
+    string buffer;
+    Vector all;
+    for(auto const& tag : tags)
+    {
+        all.push_back(Atom(tag));
+    }
+    KIWI_CHECK(encoder.encode(all, buffer));
+    messages.push_back(all);
+    for(ulong i = 0; i < 20000ul; i++)
+    {
+        Vector atoms;
+        for(ulong j = 1ul + generator() % 8ul; j; j--)
+        {
+            atoms.push_back(createAtom(generator, tags, 3ul));
+        }
+        KIWI_CHECK(encoder.encode(atoms, buffer));
+        messages.push_back(move(atoms));
+    }
+    KIWI_CHECK(decodeFrames(decoder, buffer, decoded));
+    KIWI_CHECK(decoded == messages);
+    
+    // a dropped frame is forgotten by the encoder
+    Wire::Encoder sender;
+    Wire::Decoder receiver;
+    const Vector fresh = {Atom(Tag::create("wire/fresh")), Atom(Tag::create("wire/other"))};
+    buffer.clear();
+    KIWI_CHECK(sender.encode(fresh, buffer));
+    buffer.clear();
+    sender.rollback();
+    KIWI_CHECK(sender.encode(fresh, buffer) && sender.encode(fresh, buffer));
+    decoded.clear();
+    KIWI_CHECK(decodeFrames(receiver, buffer, decoded) && decoded.size() == 2ul && decoded[0] == fresh && decoded[1] == fresh);
+    
+    // a name too large for the decoder
+    buffer = "kept";
+    KIWI_CHECK(!sender.encode({Atom(Tag::create(string(Wire::maxTagSize + 1ul, 'x')))}, buffer));
+    KIWI_CHECK(buffer == "kept");
+    
+    // a tag sent by name while the dictionary isn't full
+    const string literal = {char(1), char(Wire::TagLiteral), char(3), 'a', 'b', 'c'};
+    Vector atoms;
+    Wire::Decoder strict;
+    KIWI_CHECK(!strict.decode(literal.data(), literal.size(), atoms));
+    
+    // nested vectors that claim the bytes left in the frame, the atoms are only created as they are read
+    for(const ulong depth : {20ul, 100ul})
+    {
+        string hostile;
+        appendVarint(1ul, hostile);
+        for(ulong i = 0; i < depth; i++)
+        {
+            hostile += char(Wire::Vector);
+            appendVarint((1ul << 20) - depth * 4ul - 8ul, hostile);
+        }
+        hostile.append((1ul << 20) - hostile.size() - 1ul, char(Wire::Undefined));
+        hostile += char(0xff);
+        const ulong start = allocations.load();
+        KIWI_CHECK(!strict.decode(hostile.data(), hostile.size(), atoms));
+        KIWI_CHECK(allocations.load() - start < 4ul * hostile.size());
+    }
+    
+    // a frame with more atoms than the decoder accepts, the encoder refuses it too
+    string crowded;
+    appendVarint(Wire::maxAtoms + 1ul, crowded);
+    crowded.append(Wire::maxAtoms + 1ul, char(Wire::Undefined));
+    KIWI_CHECK(!strict.decode(crowded.data(), crowded.size(), atoms));
+    buffer = "kept";
+    KIWI_CHECK(!sender.encode(Vector(Wire::maxAtoms + 1ul), buffer));
+    KIWI_CHECK(buffer == "kept");
+    KIWI_CHECK(sender.encode(Vector(Wire::maxAtoms), buffer) && receiver.decode(buffer.data() + 8ul, buffer.size() - 8ul, atoms));
+    KIWI_CHECK(atoms.size() == Wire::maxAtoms);
+    
+    // the pending output of a socket is bounded and the socket stays open
+    int descriptors[2];
+    KIWI_CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) == 0);
+    Wire::Socket output(descriptors[0]), input(descriptors[1]);
+    Vector large;
+    for(ulong i = 0; i < 200000ul; i++)
+    {
+        large.push_back(Atom(long(generator())));
+    }
+    ulong sent = 0ul, received = 0ul;
+    while(output.send(large))
+    {
+        sent++;
+    }
+    KIWI_CHECK(output.getDescriptor() >= 0 && output.hasPendingOutput());
+    KIWI_CHECK(sent > 1ul);
+    while(received < sent)
+    {
+        KIWI_CHECK(input.receive([&received, &large](Vector& atoms){received += atoms == large;}));
+        KIWI_CHECK(output.flush());
+    }
+    KIWI_CHECK(!output.hasPendingOutput());
+    KIWI_CHECK(output.send(large));
+    
+    // a broken connection closes the socket
+    input.close();
+    KIWI_CHECK(!output.send(large) && output.getDescriptor() < 0);
+    
+    printf("%lu messages with %lu tags, %lu frames of %lu atoms queued before the backpressure\n", messages.size(), tags.size(), sent, large.size());
+    return KIWI_TEST_RESULT();
+}
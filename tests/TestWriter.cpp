@@ -0,0 +1,274 @@
+/*
+ ==============================================================================
+ 
+ This file is part of the KIWI library.
+ Copyright (c) 2014 Pierre Guillot & Eliott Paris.
+ 
+ Permission is granted to use this software under the terms of either:
+ a) the GPL v2 (or any later version)
+ b) the Affero GPL v3
+ 
+ Details of these licenses can be found at: www.gnu.org/licenses
+ 
+ KIWI is distributed in the hope that it will be useful, but WITHOUT ANY
+ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ 
+ ------------------------------------------------------------------------------
+ 
+ To release a closed-source product which uses KIWI, contact : guillotpierre6@gmail.com
+ 
+ ==============================================================================
+*/
+
+#include "KiwiTest.h"
+#include "../KiwiWriter.h"
+#include <climits>
+#include <csignal>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace Kiwi;
+
+//! Creates the atom of an object of a patch.
+static Atom createObject(const ulong index)
+{
+    Dico dico;
+    dico[Tags::id]          = Atom(long(index));
+    dico[Tags::text]        = Atom(Tag::create("writer/object/" + toString(long(index % 101ul))));
+    dico[Tags::position]    = Atom(Vector{Atom(double(index) / 8.), Atom(long(index % 300ul))});
+    dico[Tags::hidden]      = Atom(long(index % 2ul));
+    return Atom(move(dico));
+}
+
+//! Writes the objects of a patch and retrieves the text expected in the file.
+static string writeObjects(Writer& writer, const ulong count, bool& written)
+{
+    ostringstream expected;
+    written = true;
+    for(ulong i = 0; i < count; i++)
+    {
+        const Atom atom = createObject(i);
+        expected << atom;
+        written = writer.write(atom) && written;
+    }
+    return expected.str();
+}
+
+//! Retrieves the names of the files of a directory.
+static vector<string> listFiles(string const& directory)
+{
+    vector<string> files;
+    if(DIR* dir = opendir(directory.c_str()))
+    {
+        while(dirent* entry = readdir(dir))
+        {
+            const string name = entry->d_name;
+            if(name != "." && name != "..")
+            {
+                files.push_back(name);
+            }
+        }
+        closedir(dir);
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
+//! Retrieves the mode of a file.
+static mode_t getMode(string const& path)
+{
+    struct stat status;
+    return stat(path.c_str(), &status) == 0 ? (status.st_mode & 07777) : 0;
+}
+
+//! Reads a fifo until its writer closes it, slowly so the pipe is often full.
+static void readFifo(string const& path, string& text, const ulong limit)
+{
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if(file < 0)
+    {
+        return;
+    }
+    char buffer[512];
+    ulong reads = 0ul;
+    ssize_t size;
+    while(text.size() < limit && (size = read(file, buffer, sizeof(buffer))) != 0)
+    {
+        if(size > 0)
+        {
+            text.append(buffer, size_t(size));
+            if(++reads % 64ul == 0ul)
+            {
+                this_thread::sleep_for(chrono::microseconds(200));
+            }
+        }
+        else if(errno != EINTR)
+        {
+            break;
+        }
+    }
+    ::close(file);
+}
+
+static void interrupt(int)
+{
+    ;
+}
+
+// The writer must produce the text of the atoms in every mode, keep the mode of the file it replaces, resume the vectored writes cut by a signal and never leave a temporary file behind when a write fails.
+int main()
+{
+    char pattern[] = "/tmp/kiwi-test-writer-XXXXXX";
+    KIWI_CHECK(mkdtemp(pattern) != nullptr);
+    const string directory = pattern;
+    const string path = directory + "/patch.kiwi";
+    const ulong count = 20000ul;
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGXFSZ, SIG_IGN);
+    
+    // the small chunks wait for the background thread, which writes them in the order of the text
+    for(const bool async : {false, true})
+    {
+        for(const bool atomic : {false, true})
+        {
+            Writer writer(256ul, 4ul);
+            KIWI_CHECK(writer.open(path, atomic, async));
+            bool written;
+            const string expected = writeObjects(writer, count, written);
+            KIWI_CHECK(written);
+            KIWI_CHECK(writer.close());
+            KIWI_CHECK(!writer.isOpen());
+            KIWI_CHECK(readFile(path) == expected);
+            KIWI_CHECK(listFiles(directory) == vector<string>{"patch.kiwi"});
+        }
+    }
+    
+    // the replaced file keeps its mode
+    KIWI_CHECK(chmod(path.c_str(), 0640) == 0);
+    {
+        Writer writer;
+        KIWI_CHECK(writer.open(path));
+        bool written;
+        const string expected = writeObjects(writer, 10ul, written);
+        KIWI_CHECK(written && writer.close());
+        KIWI_CHECK(readFile(path) == expected);
+        KIWI_CHECK(getMode(path) == 0640);
+    }
+    
+    // the closing in the background completes the file, then the writer can be opened again
+    for(const bool async : {false, true})
+    {
+        Writer writer(256ul, 4ul);
+        KIWI_CHECK(writer.open(path, true, async));
+        bool written;
+        const string expected = writeObjects(writer, count, written);
+        future<bool> closed = writer.closeAsync();
+        KIWI_CHECK(!writer.isOpen());
+        KIWI_CHECK(!writer.write(createObject(0ul)));
+        KIWI_CHECK(written && closed.get());
+        KIWI_CHECK(readFile(path) == expected);
+        KIWI_CHECK(getMode(path) == 0640);
+        KIWI_CHECK(listFiles(directory) == vector<string>{"patch.kiwi"});
+        
+        KIWI_CHECK(writer.open(path, true, async));
+        const string again = writeObjects(writer, 10ul, written);
+        KIWI_CHECK(written && writer.close());
+        KIWI_CHECK(readFile(path) == again);
+    }
+    const string saved = readFile(path);
+    
+    // a destination that can't be replaced, the temporary file is removed
+    const string folder = directory + "/folder";
+    KIWI_CHECK(mkdir(folder.c_str(), 0755) == 0);
+    KIWI_CHECK(mkdir((folder + "/inside").c_str(), 0755) == 0);
+    for(const bool async : {false, true})
+    {
+        Writer writer;
+        KIWI_CHECK(writer.open(folder, true, async));
+        bool written;
+        writeObjects(writer, 10ul, written);
+        KIWI_CHECK(written);
+        KIWI_CHECK(!writer.close());
+        KIWI_CHECK((listFiles(directory) == vector<string>{"folder", "patch.kiwi"}));
+    }
+    
+    // a file that grows beyond the limit of the process fails while it is written, the destination is left untouched
+    struct rlimit limit;
+    KIWI_CHECK(getrlimit(RLIMIT_FSIZE, &limit) == 0);
+    const struct rlimit small = {100000, limit.rlim_max};
+    for(const bool async : {false, true})
+    {
+        for(const bool background : {false, true})
+        {
+            KIWI_CHECK(setrlimit(RLIMIT_FSIZE, &small) == 0);
+            Writer writer(4096ul, 4ul);
+            KIWI_CHECK(writer.open(path, true, async));
+            bool written;
+            writeObjects(writer, count, written);
+            KIWI_CHECK(!written);
+            KIWI_CHECK(!(background ? writer.closeAsync().get() : writer.close()));
+            KIWI_CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+            KIWI_CHECK(readFile(path) == saved);
+            KIWI_CHECK((listFiles(directory) == vector<string>{"folder", "patch.kiwi"}));
+        }
+    }
+    
+    // a pipe whose reader stops reading fails the write instead of blocking
+    const string fifo = directory + "/fifo";
+    KIWI_CHECK(mkfifo(fifo.c_str(), 0600) == 0);
+    {
+        string text;
+        thread reader(readFifo, fifo, ref(text), 4096ul);
+        Writer writer(4096ul, 4ul);
+        KIWI_CHECK(writer.open(fifo, false));
+        bool written;
+        writeObjects(writer, count, written);
+        KIWI_CHECK(!written);
+        KIWI_CHECK(!writer.close());
+        reader.join();
+    }
+    
+    // the writes to a full pipe are cut by a signal, the vectored writes resume where they stopped
+    ulong interrupted = 0ul;
+    {
+        string text;
+        sigset_t alarm, previous;
+        sigemptyset(&alarm);
+        sigaddset(&alarm, SIGALRM);
+        pthread_sigmask(SIG_BLOCK, &alarm, &previous);
+        thread reader(readFifo, fifo, ref(text), ULONG_MAX);
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+        
+        struct sigaction action = {};
+        action.sa_handler = interrupt;
+        sigemptyset(&action.sa_mask);
+        KIWI_CHECK(sigaction(SIGALRM, &action, nullptr) == 0);
+        
+        Writer writer(65536ul, 4ul);
+        KIWI_CHECK(writer.open(fifo, false));
+        const struct itimerval timer = {{0, 100}, {0, 100}}, stop = {{0, 0}, {0, 0}};
+        setitimer(ITIMER_REAL, &timer, nullptr);
+        bool written;
+        const string expected = writeObjects(writer, count * 5ul, written);
+        setitimer(ITIMER_REAL, &stop, nullptr);
+        KIWI_CHECK(written);
+        KIWI_CHECK(writer.close());
+        reader.join();
+        KIWI_CHECK(text == expected);
+        interrupted = ulong(expected.size());
+    }
+    
+    unlink(fifo.c_str());
+    unlink(path.c_str());
+    rmdir((folder + "/inside").c_str());
+    rmdir(folder.c_str());
+    rmdir(directory.c_str());
+    
+    printf("%lu objects written in every mode, %lu bytes through an interrupted pipe\n", count, interrupted);
+    return KIWI_TEST_RESULT();
+}